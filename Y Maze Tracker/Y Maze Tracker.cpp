@@ -4,19 +4,25 @@
 #include "framework.h"
 #include "Y Maze Tracker.h"
 #include "cvHighGUI.h"
+#include "trackingEngine.h"
+#include "previewMailbox.h"
+#include "checkpoint.h"
+#include "traceRecorder.h"
+#include "metricsServer.h"
+#include "frameOverlay.h"
+#include "allocCounter.h"
 
 #include <opencv2/core.hpp>
 #include <opencv2/imgproc.hpp>
 #include <opencv2/videoio.hpp>
-#include <opencv2/video/background_segm.hpp>
-#include <opencv2/video/tracking.hpp>
-#include <opencv2/tracking.hpp>
-#include <opencv2/tracking/tracking_legacy.hpp>
 
 #include <shobjidl.h>
 #include <map>
 #include <codecvt>
 #include <string>
+#include <thread>
+#include <atomic>
+#include <memory>
 
 using namespace cv;
 using namespace std;
@@ -29,17 +35,17 @@ BOOL                InitInstance(HINSTANCE, int);
 LRESULT CALLBACK    WndProc(HWND, UINT, WPARAM, LPARAM);
 INT_PTR CALLBACK    About(HWND, UINT, WPARAM, LPARAM);
 void                openFileDialog(HWND);
-Ptr<Tracker>		getTracker(HWND);
-void				mouseTracking(HWND, Ptr<Tracker>, PWSTR);
+string				getTrackerType(HWND);
+void				mouseTracking(HWND, const string&, PWSTR);
+void				drawOverlay(PreviewFrame&, const FrameOverlay&, const StageTimers*, int64_t);
 void CALLBACK		setCenterCoord(int, int, int, int, void*);
-bool				PointInTriangle(Point2f, Point2f, Point2f, Point2f);
 string				wstring_to_utf8(const wstring&);
+wstring				utf8_to_wstring(const string&);
 
 // Global Variables:
 HINSTANCE hInst;                                // current instance
 WCHAR szTitle[MAX_LOADSTRING];                  // The title bar text
 WCHAR szWindowClass[MAX_LOADSTRING];            // the main window class name
-String selectedTrackerType;						// selected tracker type
 array<Point, 3> triangleCoords;					// cordinates of the triangle
 Mat firstFrame;									// first frame of video
 
@@ -54,6 +60,8 @@ const map<int, const wchar_t*> trackerTypes = {
 	{IDC_TLD, L"TLD"},
 	{IDC_MEDIANFLOW, L"MEDIANFLOW"},
 	{IDC_MOSSE, L"MOSSE"},
+	{IDC_BACKSUBTRACKER, L"BACKSUB"},
+	{IDC_MEDIANBG, L"MEDIANBG"},
 };
 
 int APIENTRY wWinMain(_In_ HINSTANCE hInstance,
@@ -62,6 +70,9 @@ int APIENTRY wWinMain(_In_ HINSTANCE hInstance,
 	_In_ int       nCmdShow) {
 	UNREFERENCED_PARAMETER(hPrevInstance);
 	UNREFERENCED_PARAMETER(lpCmdLine);
+	// the preview loop counts its allocations, Mat buffers included, in the
+	// Debug configurations that compile allocHooks.cpp
+	installMatAllocationCounter();
 
 	// Initialize global strings
 	LoadStringW(hInstance, IDS_APP_TITLE, szTitle, MAX_LOADSTRING);
@@ -130,7 +141,7 @@ BOOL InitInstance(HINSTANCE hInstance, int nCmdShow) {
 	hInst = hInstance; // Store instance handle in our global variable
 
 	HWND hWnd = CreateWindowW(szWindowClass, szTitle, WS_OVERLAPPEDWINDOW,
-		CW_USEDEFAULT, 0, 200, 380, nullptr, nullptr, hInstance, nullptr);
+		CW_USEDEFAULT, 0, 200, 620, nullptr, nullptr, hInstance, nullptr);
 
 	if (!hWnd) {
 		return FALSE;
@@ -165,6 +176,23 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
 			y += 30;
 		}
 		CreateWindowEx(WS_EX_WINDOWEDGE, L"BUTTON", L"启用背景差分", WS_VISIBLE | WS_CHILD | BS_AUTOCHECKBOX, 10, y, 180, 20, hWnd, (HMENU)IDC_BACKSUB, hInst, NULL);
+		y += 30;
+		// the list height is the height of the opened drop down
+		auto preview = CreateWindowEx(WS_EX_WINDOWEDGE, L"COMBOBOX", NULL, WS_VISIBLE | WS_CHILD | WS_VSCROLL | CBS_DROPDOWNLIST, 10, y, 180, 120, hWnd, (HMENU)IDC_PREVIEW, hInst, NULL);
+		for (auto name : { L"预览：实时", L"预览：每10帧", L"预览：最多10帧/秒", L"预览：关闭" }) {
+			SendMessage(preview, CB_ADDSTRING, 0, (LPARAM)name);
+		}
+		SendMessage(preview, CB_SETCURSEL, PreviewRate::LIVE, 0);
+		y += 30;
+		CreateWindowEx(WS_EX_WINDOWEDGE, L"BUTTON", L"启用卡尔曼预测", WS_VISIBLE | WS_CHILD | BS_AUTOCHECKBOX, 10, y, 180, 20, hWnd, (HMENU)IDC_KALMAN, hInst, NULL);
+		y += 30;
+		CreateWindowEx(WS_EX_WINDOWEDGE, L"BUTTON", L"跟丢后自动找回", WS_VISIBLE | WS_CHILD | BS_AUTOCHECKBOX, 10, y, 180, 20, hWnd, (HMENU)IDC_REACQUIRE, hInst, NULL);
+		y += 30;
+		CreateWindowEx(WS_EX_WINDOWEDGE, L"BUTTON", L"记录性能追踪", WS_VISIBLE | WS_CHILD | BS_AUTOCHECKBOX, 10, y, 180, 20, hWnd, (HMENU)IDC_TRACE, hInst, NULL);
+		y += 30;
+		CreateWindowEx(WS_EX_WINDOWEDGE, L"BUTTON", L"导出标注视频", WS_VISIBLE | WS_CHILD | BS_AUTOCHECKBOX, 10, y, 180, 20, hWnd, (HMENU)IDC_EXPORT, hInst, NULL);
+		y += 30;
+		CreateWindowEx(WS_EX_WINDOWEDGE, L"BUTTON", L"提供实时指标", WS_VISIBLE | WS_CHILD | BS_AUTOCHECKBOX, 10, y, 180, 20, hWnd, (HMENU)IDC_METRICS, hInst, NULL);
 		SendMessage(GetDlgItem(hWnd, IDC_GOTURN), BM_SETCHECK, BST_CHECKED, 0);
 		break;
 	}
@@ -243,8 +271,7 @@ void openFileDialog(HWND hDlg) {
 
 					// Display the file name to the user.
 					if (SUCCEEDED(hr)) {
-						Ptr<Tracker> tracker = getTracker(hDlg);
-						mouseTracking(hDlg, tracker, pszFilePath);
+						mouseTracking(hDlg, getTrackerType(hDlg), pszFilePath);
 					}
 					CoTaskMemFree(pszFilePath);
 					pItem->Release();
@@ -256,121 +283,193 @@ void openFileDialog(HWND hDlg) {
 	}
 }
 
-Ptr<Tracker> getTracker(HWND hDlg) {
+string getTrackerType(HWND hDlg) {
 	for (auto const& [id, name] : trackerTypes) {
 		if (IsDlgButtonChecked(hDlg, id) == BST_CHECKED) {
-			selectedTrackerType = wstring_to_utf8(name);
-			switch (id) {
-			case IDC_BOOSTING:
-				return upgradeTrackingAPI(legacy::TrackerBoosting::create());
-			case IDC_MIL:
-				return TrackerMIL::create();
-			case IDC_KCF:
-				return TrackerKCF::create();
-			case IDC_TLD:
-				return upgradeTrackingAPI(legacy::TrackerTLD::create());
-			case IDC_MEDIANFLOW:
-				return upgradeTrackingAPI(legacy::TrackerMedianFlow::create());
-			case IDC_MOSSE:
-				return upgradeTrackingAPI(legacy::TrackerMOSSE::create());
-			case IDC_CSRT: {
-				auto params = TrackerCSRT::Params();
-				params.use_color_names = true;
-				return TrackerCSRT::create(params);
-			}
-			case IDC_GOTURN: 
-				return TrackerGOTURN::create();
-			case IDC_DASIAMRPN:
-				return TrackerDaSiamRPN::create();
-			default:
-				break;
-			}
-			break;
+			return wstring_to_utf8(name);
 		}
 	}
+	return string();
 }
 
-void mouseTracking(HWND hDlg, Ptr<Tracker> tracker, PWSTR filename) {
-	const bool useBackSub = IsDlgButtonChecked(hDlg, IDC_BACKSUB) == BST_CHECKED;
-	Ptr<BackgroundSubtractor> pBackSub;
-	if (useBackSub) {
-		//create Background Subtractor objects
-		pBackSub = createBackgroundSubtractorMOG2();
+void mouseTracking(HWND hDlg, const string& trackerType, PWSTR filename) {
+	TrackingSession session;
+	session.videoPath = wstring_to_utf8(filename);
+	session.trackerType = trackerType;
+	session.useBackSub = IsDlgButtonChecked(hDlg, IDC_BACKSUB) == BST_CHECKED;
+	session.predictWindow = IsDlgButtonChecked(hDlg, IDC_KALMAN) == BST_CHECKED;
+	session.reacquire = IsDlgButtonChecked(hDlg, IDC_REACQUIRE) == BST_CHECKED;
+	// opens in chrome://tracing or ui.perfetto.dev
+	if (IsDlgButtonChecked(hDlg, IDC_TRACE) == BST_CHECKED) {
+		session.trace = make_shared<TraceRecorder>(session.videoPath + ".trace.json");
+		session.trace->nameThread("render");
 	}
+	// runs with this checked are listed at http://127.0.0.1:9464/metrics, the
+	// server starts with the first of them and a second instance that finds
+	// the port taken goes without
+	static unique_ptr<MetricsServer> metrics;
+	if (IsDlgButtonChecked(hDlg, IDC_METRICS) == BST_CHECKED) {
+		if (!metrics || !metrics->isOpen()) {
+			metrics = make_unique<MetricsServer>(9464);
+		}
+		if (metrics->isOpen()) {
+			// the previous run stays listed until this one starts
+			metrics->removeFinished();
+			session.metrics = make_shared<LiveMetrics>(session.videoPath, session.trackerType);
+			metrics->add(session.metrics);
+		}
+	}
+	// reviewed later at any speed, e.g. with the preview off
+	if (IsDlgButtonChecked(hDlg, IDC_EXPORT) == BST_CHECKED) {
+		session.annotatedPath = session.videoPath + ".annotated.avi";
+	}
+	// keep the trajectory next to the video for later analysis
+	session.trajectoryBinPath = session.videoPath + ".ymt";
+	// an interrupted run can be continued from here, the file is removed once the video is done
+	session.checkpointPath = session.videoPath + ".ckpt";
+	session.resume = checkpointExists(session.checkpointPath) &&
+		MessageBox(hDlg, L"上次的追踪没有完成，是否从中断处继续？", filename, MB_YESNO | MB_ICONQUESTION) == IDYES;
 
 	cvNamedWindow(windowname, WINDOW_NORMAL | WINDOW_KEEPRATIO | WINDOW_GUI_EXPANDED | CV_WINDOW_OPENGL);
 
-	auto cap = VideoCapture(wstring_to_utf8(filename));
+	auto cap = VideoCapture(session.videoPath);
 	if (!cap.isOpened()) {
 		MessageBox(hDlg, L"Could not open the input video", filename, MB_ICONERROR);
 		return;
 	}
-	Mat src, fgMask;
+	Mat src;
 	cap >> src;
-	firstFrame = src.clone();
-	putText(firstFrame, "select center of the maze and then press enter", Point(100, 80), FONT_HERSHEY_COMPLEX, 0.75, Scalar(0, 0, 255), 2);
-	cvSetMouseCallback(windowname, setCenterCoord, NULL);
-	cvShowImage(windowname, firstFrame);
-	cvWaitKey(0);
-	fillPoly(firstFrame, triangleCoords, Scalar(255, 0, 0));
-	cvShowImage(windowname, firstFrame);
-	cvWaitKey(0);
-
-	Mat findMouse = src.clone();
-	putText(findMouse, "box select the mouse and then press enter", Point(100, 80), FONT_HERSHEY_COMPLEX, 0.75, Scalar(0, 0, 255), 2);
-	auto bbox = selectROI(windowname, findMouse, false, false);
-	// Initialize tracker with first frame and bounding box
-	tracker->init(src, bbox);
-	int a = 0, b = 0, c = 0, in_center = 0;
-
-	for (auto frame = 1; !src.empty(); frame++, cap >> src) {
-		if (useBackSub) {
-			//update the background model
-			pBackSub->apply(src, fgMask);
-		}
+	cap.release();
+	// a resumed run takes the maze and the mouse from the checkpoint
+	if (!session.resume) {
+		firstFrame = src.clone();
+		putText(firstFrame, "select center of the maze and then press enter", Point(100, 80), FONT_HERSHEY_COMPLEX, 0.75, Scalar(0, 0, 255), 2);
+		cvSetMouseCallback(windowname, setCenterCoord, NULL);
+		cvShowImage(windowname, firstFrame);
+		cvWaitKey(0);
+		fillPoly(firstFrame, triangleCoords, Scalar(255, 0, 0));
+		cvShowImage(windowname, firstFrame);
+		cvWaitKey(0);
+		session.triangle = triangleCoords;
+
+		Mat findMouse = src.clone();
+		putText(findMouse, "box select the mouse and then press enter", Point(100, 80), FONT_HERSHEY_COMPLEX, 0.75, Scalar(0, 0, 255), 2);
+		session.bbox = selectROI(windowname, findMouse, false, false);
+	}
 
-		auto display = src.clone();
-		string arm;
-		// Update tracker
-		if (tracker->update(src, bbox)) {
-			// Tracking success
-			auto p1 = Point(bbox.x, bbox.y);
-			auto p2 = Point(bbox.x + bbox.width, bbox.y + bbox.height);
-			auto mouse_center = Point((p1.x + p2.x) / 2, (p1.y + p2.y) / 2);
-			auto center_coord = Point((triangleCoords[0].x + triangleCoords[1].x + triangleCoords[2].x) / 3, (triangleCoords[0].y + triangleCoords[1].y + triangleCoords[2].y) / 3);
-			if (PointInTriangle(mouse_center, triangleCoords[0], triangleCoords[1], triangleCoords[2])) {
-				arm = "center";
-				in_center += 1;
-			} else if (mouse_center.y > center_coord.y) {
-				arm = 'c';
-				c += 1;
-			} else if (mouse_center.x > center_coord.x) {
-				arm = 'b';
-				b += 1;
-			} else {
-				arm = 'a';
-				a += 1;
+	// track on a worker thread, this thread only renders the newest tracked frame
+	PreviewRate rate;
+	// the drop down lists the modes in PreviewRate::Mode order
+	auto mode = SendMessage(GetDlgItem(hDlg, IDC_PREVIEW), CB_GETCURSEL, 0, 0);
+	if (mode >= PreviewRate::LIVE && mode <= PreviewRate::OFF) {
+		rate.mode = (PreviewRate::Mode)mode;
+	}
+	if (rate.mode == PreviewRate::OFF) {
+		// the window stays for the ESC key
+		Mat idle = src.clone();
+		putText(idle, "preview off, press ESC to stop", Point(100, 80), FONT_HERSHEY_COMPLEX, 0.75, Scalar(0, 0, 255), 2);
+		cvShowImage(windowname, idle);
+	}
+	PreviewMailbox mailbox(rate);
+	// every buffer the preview needs is sized here, the loop below only reuses them
+	PreviewFrame preview;
+	mailbox.reserve(src.size(), src.type());
+	preview.image.create(src.size(), src.type());
+	const FrameOverlay overlay(session.trackerType);
+	atomic<bool> done = false, cancelled = false;
+	TrackingResult result;
+	string error;
+	bool ok = false;
+	thread worker([&] {
+		ok = runTracking(session, result, [&](const FrameInfo& info) {
+			mailbox.offer(info);
+			return !cancelled.load(memory_order_relaxed);
+		}, &error);
+		done = true;
+	});
+
+	// the render stages, the engine times its own on the worker thread
+	StageTimers uiTimings;
+	uiTimings.traceTo(session.trace.get());
+	bool showTimings = false;
+	// heap allocations of taking and annotating a frame, expected to stay 0
+	int64_t renderAllocations = 0;
+	while (!done) {
+		auto allocationsBefore = threadAllocations();
+		if (mailbox.take(preview)) {
+			uiTimings.traceFrame(preview.frame);
+			{
+				ScopedStage timer(&uiTimings, STAGE_OVERLAY);
+				drawOverlay(preview, overlay, showTimings ? &uiTimings : nullptr, renderAllocations);
 			}
-			rectangle(display, p1, p2, Scalar(255, 25, 25), 2, 1);
-			circle(display, mouse_center, 3, Scalar(25, 25, 255), 1);
-		} else {
-			// Tracking failure
-			putText(display, "Tracking failure detected", Point(100, 80), FONT_HERSHEY_COMPLEX, 0.75, Scalar(0, 0, 255), 2);
+			renderAllocations += threadAllocations() - allocationsBefore;
+			ScopedStage timer(&uiTimings, STAGE_SHOW);
+			// Display result
+			cvShowImage(windowname, preview.image);
+		}
+		int key;
+		{
+			ScopedStage timer(&uiTimings, STAGE_WAITKEY);
+			key = cvWaitKey(rate.waitMs());
 		}
-		// Display tracker type on frame
-		putText(display, selectedTrackerType + " Tracker", Point(100, 20), FONT_HERSHEY_COMPLEX, 0.75, Scalar(50, 170, 50), 2);
-
-		// Display FPS on frame
-		putText(display, "Frame:" + to_string(frame) + ", Arm:" + arm, Point(100, 50), FONT_HERSHEY_COMPLEX, 0.75, Scalar(50, 170, 50), 2);
-		// Display result
-		cvShowImage(windowname, display);
 		// Exit if ESC pressed
-		cvWaitKey(1);
+		if (key == 27) {
+			cancelled = true;
+		} else if (key == 't' || key == 'T') {
+			// toggle the per-stage timing overlay
+			showTimings = !showTimings;
+		}
 	}
-	cap.release();
+	worker.join();
 	cvDestroyAllWindows();
-	wstring result = L"center:" + to_wstring(in_center) + L", a:" + to_wstring(a) + L", b:" + to_wstring(b) + L", c:" + to_wstring(c);
-	MessageBox(hDlg, result.c_str(), L"结果", MB_OK);
+	// shows up in the debugger output
+	result.timings.merge(uiTimings);
+	uiTimings.traceTo(nullptr);
+	if (session.trace) {
+		session.trace->close();
+	}
+	OutputDebugStringA(result.timings.summary().c_str());
+	if (allocationsCounted()) {
+		char allocations[128];
+		snprintf(allocations, sizeof(allocations), "heap allocations: %lld tracking, %lld preview\n", (long long)result.loopAllocations,
+			(long long)renderAllocations);
+		OutputDebugStringA(allocations);
+	}
+	if (!ok) {
+		MessageBox(hDlg, utf8_to_wstring(error).c_str(), filename, MB_ICONERROR);
+		return;
+	}
+	wstring text = L"center:" + to_wstring(result.in_center) + L", a:" + to_wstring(result.a) + L", b:" + to_wstring(result.b) + L", c:" + to_wstring(result.c);
+	auto& behavior = result.behavior;
+	text += L"\nentries:" + to_wstring(behavior.armEntries) + L" " + utf8_to_wstring(behavior.entrySequence) +
+		L"\nalternations:" + to_wstring(behavior.alternations) + L" (" + to_wstring((int)(behavior.alternationPercent() + 0.5)) + L"%)" +
+		L"\ndistance:" + to_wstring((int)behavior.distance) + L" px, mean speed:" + to_wstring((int)behavior.meanSpeed()) + L" px/s";
+	if (result.reacquisitions > 0) {
+		text += L"\nreacquired:" + to_wstring(result.reacquisitions) + L", recovered frames:" + to_wstring(result.recoveredFrames);
+	}
+	MessageBox(hDlg, text.c_str(), L"结果", MB_OK);
+}
+
+void drawOverlay(PreviewFrame& preview, const FrameOverlay& overlay, const StageTimers* uiTimings, int64_t renderAllocations) {
+	auto& display = preview.image;
+	overlay.draw(display, preview.frame, preview.bbox, preview.success, preview.zone);
+
+	if (uiTimings) {
+		// mean time of every stage so far, the render stages are timed on this thread
+		auto y = 110;
+		char text[64];
+		for (auto i = 0; i < STAGE_COUNT; i++) {
+			auto stage = (Stage)i;
+			auto ms = stage >= STAGE_OVERLAY ? (*uiTimings)[stage].meanMs() : preview.stageMeanMs[i];
+			snprintf(text, sizeof(text), "%-9s %7.2f ms", stageNames[i], ms);
+			overlay.drawLine(display, text, Point(100, y));
+			y += 20;
+		}
+		if (allocationsCounted()) {
+			snprintf(text, sizeof(text), "%-9s %7lld", "allocs", (long long)renderAllocations);
+			overlay.drawLine(display, text, Point(100, y));
+		}
+	}
 }
 
 void CALLBACK setCenterCoord(int event, int x, int y, int, void*) {
@@ -386,24 +485,6 @@ void CALLBACK setCenterCoord(int event, int x, int y, int, void*) {
 	}
 }
 
-float sign(Point2f p1, Point2f p2, Point2f p3) {
-	return (p1.x - p3.x) * (p2.y - p3.y) - (p2.x - p3.x) * (p1.y - p3.y);
-}
-
-bool PointInTriangle(Point2f pt, Point2f v1, Point2f v2, Point2f v3) {
-	float d1, d2, d3;
-	bool has_neg, has_pos;
-
-	d1 = sign(pt, v1, v2);
-	d2 = sign(pt, v2, v3);
-	d3 = sign(pt, v3, v1);
-
-	has_neg = (d1 < 0) || (d2 < 0) || (d3 < 0);
-	has_pos = (d1 > 0) || (d2 > 0) || (d3 > 0);
-
-	return !(has_neg && has_pos);
-}
-
 // convert wstring to UTF-8 string
 string wstring_to_utf8(const wstring& wstr) {
 	if (wstr.empty()) return string();
@@ -411,4 +492,13 @@ string wstring_to_utf8(const wstring& wstr) {
 	string strTo(size_needed, 0);
 	WideCharToMultiByte(CP_UTF8, 0, &wstr[0], (int)wstr.size(), &strTo[0], size_needed, NULL, NULL);
 	return strTo;
+}
+
+// convert UTF-8 string to wstring
+wstring utf8_to_wstring(const string& str) {
+	if (str.empty()) return wstring();
+	int size_needed = MultiByteToWideChar(CP_UTF8, 0, &str[0], (int)str.size(), NULL, 0);
+	wstring wstrTo(size_needed, 0);
+	MultiByteToWideChar(CP_UTF8, 0, &str[0], (int)str.size(), &wstrTo[0], size_needed);
+	return wstrTo;
 }
\ No newline at end of file
@@ -0,0 +1,66 @@
+// allocCounter.cpp : The per-thread counter and a counting
+// cv::MatAllocator, the operator new side is in allocHooks.cpp.
+//
+
+#include "allocCounter.h"
+
+#include <opencv2/core.hpp>
+
+using namespace cv;
+using namespace std;
+
+// a plain counter, only its own thread writes it
+static thread_local int64_t allocations = 0;
+
+int64_t threadAllocations() {
+	return allocations;
+}
+
+void countAllocation() {
+	allocations += 1;
+}
+
+static bool counting = false;
+
+void enableAllocationCounting() {
+	counting = true;
+}
+
+bool allocationsCounted() {
+	return counting;
+}
+
+// Mat data comes from cv::fastMalloc, which operator new never sees
+class CountingMatAllocator : public MatAllocator {
+public:
+	CountingMatAllocator(MatAllocator* base) : base(base) {}
+
+	UMatData* allocate(int dims, const int* sizes, int type, void* data, size_t* step, AccessFlag flags,
+		UMatUsageFlags usageFlags) const override {
+		if (!data) {
+			allocations += 1;
+		}
+		// the base sets itself as the owner, so it also gets the deallocate
+		return base->allocate(dims, sizes, type, data, step, flags, usageFlags);
+	}
+
+	bool allocate(UMatData* data, AccessFlag accessFlags, UMatUsageFlags usageFlags) const override {
+		return base->allocate(data, accessFlags, usageFlags);
+	}
+
+	void deallocate(UMatData* data) const override {
+		base->deallocate(data);
+	}
+
+private:
+	MatAllocator* base;
+};
+
+void installMatAllocationCounter() {
+	// Mat buffers alone would be a misleading count
+	if (!counting) {
+		return;
+	}
+	static CountingMatAllocator counting(Mat::getStdAllocator());
+	Mat::setDefaultAllocator(&counting);
+}
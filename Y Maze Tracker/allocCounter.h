@@ -0,0 +1,22 @@
+// allocCounter.h : per-thread heap allocation counter, used to check that the
+// steady-state loops allocate nothing per frame.
+//
+
+#pragma once
+
+#include <cstdint>
+
+// operator new calls made by the calling thread so far, plus the cv::Mat
+// buffers it allocated once installMatAllocationCounter() ran. Only counted
+// in builds that link allocHooks.cpp, which replaces the global operator new
+int64_t threadAllocations();
+// true in those builds, the count stays 0 in every other one
+bool allocationsCounted();
+
+// routes cv::Mat buffers through a counting wrapper of the default
+// allocator, call before any Mat is created. Does nothing unless counted
+void installMatAllocationCounter();
+
+// for allocHooks.cpp
+void enableAllocationCounting();
+void countAllocation();
@@ -0,0 +1,125 @@
+// allocHooks.cpp : Replacement operator new / delete feeding allocCounter,
+// linked only into the builds that report heap allocations.
+//
+
+#include "allocCounter.h"
+
+#include <cstdlib>
+#include <new>
+
+using namespace std;
+
+// a static library member with nothing referenced from it would be dropped,
+// this file is always linked as an object, so its initializer always runs
+[[maybe_unused]] static const bool linked = (enableAllocationCounting(), true);
+
+static void* allocate(size_t size) {
+	countAllocation();
+	// malloc(0) may return null, new may not
+	return malloc(size ? size : 1);
+}
+
+static void* allocateAligned(size_t size, align_val_t alignment) {
+	countAllocation();
+	auto align = (size_t)alignment;
+#ifdef _WIN32
+	return _aligned_malloc(size ? size : 1, align);
+#else
+	// aligned_alloc takes whole multiples of the alignment only
+	return aligned_alloc(align, ((size ? size : 1) + align - 1) / align * align);
+#endif
+}
+
+static void freeAligned(void* p) {
+#ifdef _WIN32
+	_aligned_free(p);
+#else
+	free(p);
+#endif
+}
+
+void* operator new(size_t size) {
+	if (auto p = allocate(size)) {
+		return p;
+	}
+	throw bad_alloc();
+}
+
+void* operator new[](size_t size) {
+	return operator new(size);
+}
+
+void* operator new(size_t size, const nothrow_t&) noexcept {
+	return allocate(size);
+}
+
+void* operator new[](size_t size, const nothrow_t&) noexcept {
+	return allocate(size);
+}
+
+void* operator new(size_t size, align_val_t alignment) {
+	if (auto p = allocateAligned(size, alignment)) {
+		return p;
+	}
+	throw bad_alloc();
+}
+
+void* operator new[](size_t size, align_val_t alignment) {
+	return operator new(size, alignment);
+}
+
+void* operator new(size_t size, align_val_t alignment, const nothrow_t&) noexcept {
+	return allocateAligned(size, alignment);
+}
+
+void* operator new[](size_t size, align_val_t alignment, const nothrow_t&) noexcept {
+	return allocateAligned(size, alignment);
+}
+
+void operator delete(void* p) noexcept {
+	free(p);
+}
+
+void operator delete[](void* p) noexcept {
+	free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+	free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept {
+	free(p);
+}
+
+void operator delete(void* p, const nothrow_t&) noexcept {
+	free(p);
+}
+
+void operator delete[](void* p, const nothrow_t&) noexcept {
+	free(p);
+}
+
+void operator delete(void* p, align_val_t) noexcept {
+	freeAligned(p);
+}
+
+void operator delete[](void* p, align_val_t) noexcept {
+	freeAligned(p);
+}
+
+void operator delete(void* p, size_t, align_val_t) noexcept {
+	freeAligned(p);
+}
+
+void operator delete[](void* p, size_t, align_val_t) noexcept {
+	freeAligned(p);
+}
+
+void operator delete(void* p, align_val_t, const nothrow_t&) noexcept {
+	freeAligned(p);
+}
+
+void operator delete[](void* p, align_val_t, const nothrow_t&) noexcept {
+	freeAligned(p);
+}
@@ -0,0 +1,82 @@
+// annotatedVideo.cpp : Bounded frame queue between the tracking loop and
+// cv::VideoWriter.
+//
+
+#include "annotatedVideo.h"
+
+using namespace cv;
+using namespace std;
+
+AnnotatedVideoWriter::AnnotatedVideoWriter(const string& path, double fps, const Size& size, const string& trackerType,
+	size_t queueFrames)
+	: writer(path, VideoWriter::fourcc('M', 'J', 'P', 'G'), fps > 0 ? fps : 30, size), overlay(trackerType),
+	slots(max<size_t>(queueFrames, 1)) {
+	if (!writer.isOpened()) {
+		return;
+	}
+	for (auto& slot : slots) {
+		slot.image.create(size, CV_8UC3);
+	}
+	worker = thread(&AnnotatedVideoWriter::encodeLoop, this);
+}
+
+AnnotatedVideoWriter::~AnnotatedVideoWriter() {
+	close();
+}
+
+void AnnotatedVideoWriter::write(const FrameInfo& info) {
+	if (!worker.joinable()) {
+		return;
+	}
+	unique_lock<mutex> lock(queueMutex);
+	// every frame ends up in the file, a slow encoder slows the run down
+	notFull.wait(lock, [this] { return count < slots.size(); });
+	// the slot at head + count is not visible to the writer, copy without the lock
+	auto& slot = slots[(head + count) % slots.size()];
+	lock.unlock();
+	info.image.copyTo(slot.image);
+	slot.frame = info.frame;
+	slot.bbox = info.bbox;
+	slot.success = info.success;
+	slot.zone = info.zone;
+
+	lock.lock();
+	count += 1;
+	notEmpty.notify_one();
+}
+
+void AnnotatedVideoWriter::encodeLoop() {
+	for (;;) {
+		Slot* slot;
+		{
+			unique_lock<mutex> lock(queueMutex);
+			notEmpty.wait(lock, [this] { return count > 0 || stopping; });
+			if (count == 0) {
+				break;
+			}
+			slot = &slots[head];
+		}
+
+		overlay.draw(slot->image, slot->frame, slot->bbox, slot->success, slot->zone);
+		writer.write(slot->image);
+
+		lock_guard<mutex> lock(queueMutex);
+		head = (head + 1) % slots.size();
+		count -= 1;
+		notFull.notify_one();
+	}
+}
+
+void AnnotatedVideoWriter::close() {
+	if (!worker.joinable()) {
+		return;
+	}
+	{
+		lock_guard<mutex> lock(queueMutex);
+		stopping = true;
+	}
+	// the writer drains the queue before it sees stopping
+	notEmpty.notify_all();
+	worker.join();
+	writer.release();
+}
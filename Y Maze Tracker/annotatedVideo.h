@@ -0,0 +1,58 @@
+// annotatedVideo.h : encodes the tracked frames with their annotations to a
+// video file on a dedicated thread, so a run can go headless at full speed
+// and still be reviewed afterwards.
+//
+
+#pragma once
+
+#include "trackingEngine.h"
+#include "frameOverlay.h"
+
+#include <opencv2/core.hpp>
+#include <opencv2/videoio.hpp>
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class AnnotatedVideoWriter {
+public:
+	// MJPG, readable by every player and cheap to encode; queueFrames frames
+	// of size are preallocated, write() waits when all of them are queued
+	AnnotatedVideoWriter(const std::string& path, double fps, const cv::Size& size, const std::string& trackerType,
+		size_t queueFrames = 8);
+	~AnnotatedVideoWriter();
+	AnnotatedVideoWriter(const AnnotatedVideoWriter&) = delete;
+	AnnotatedVideoWriter& operator=(const AnnotatedVideoWriter&) = delete;
+
+	bool isOpen() const { return writer.isOpened(); }
+
+	// tracking thread: copies the frame into a free slot, drawing and
+	// encoding happen on the writer thread
+	void write(const FrameInfo& info);
+	// encodes everything queued and closes the file
+	void close();
+
+private:
+	struct Slot {
+		cv::Mat image;
+		int frame = 0;
+		cv::Rect bbox;
+		bool success = false;
+		Zone zone = ZONE_NONE;
+	};
+
+	void encodeLoop();
+
+	cv::VideoWriter writer;
+	const FrameOverlay overlay;
+	std::vector<Slot> slots;
+	size_t head = 0;		// oldest queued slot, owned by the writer thread
+	size_t count = 0;		// queued slots
+	bool stopping = false;
+	std::mutex queueMutex;
+	std::condition_variable notEmpty, notFull;
+	std::thread worker;
+};
@@ -0,0 +1,93 @@
+// backSubTracker.cpp : Threshold the MOG2 foreground, keep the largest blob,
+// report its centroid and bounding box.
+//
+
+#include "backSubTracker.h"
+
+#include <opencv2/imgproc.hpp>
+
+using namespace cv;
+using namespace std;
+
+// label of the largest connected component, 0 if the mask is empty
+static int largestComponent(const Mat& mask, Mat& labels, Mat& stats, Mat& centroids) {
+	auto count = connectedComponentsWithStats(mask, labels, stats, centroids, 8, CV_32S);
+	auto best = 0;
+	for (auto i = 1; i < count; i++) {
+		if (best == 0 || stats.at<int>(i, CC_STAT_AREA) > stats.at<int>(best, CC_STAT_AREA)) {
+			best = i;
+		}
+	}
+	return best;
+}
+
+bool findLargestBlob(const Mat& mask, Rect& blob, Point2f& centroid, int minArea) {
+	Mat labels, stats, centroids;
+	auto best = largestComponent(mask, labels, stats, centroids);
+	if (best == 0 || stats.at<int>(best, CC_STAT_AREA) < minArea) {
+		return false;
+	}
+	blob = Rect(stats.at<int>(best, CC_STAT_LEFT), stats.at<int>(best, CC_STAT_TOP),
+		stats.at<int>(best, CC_STAT_WIDTH), stats.at<int>(best, CC_STAT_HEIGHT));
+	centroid = Point2f((float)centroids.at<double>(best, 0), (float)centroids.at<double>(best, 1));
+	return true;
+}
+
+TrackerBackSub::Params::Params() {
+	history = 500;
+	varThreshold = 16;
+	learningRate = -1;
+	scale = 0.5;
+	openKernel = 3;
+	minArea = 30;
+}
+
+Ptr<TrackerBackSub> TrackerBackSub::create(const Params& parameters) {
+	return makePtr<TrackerBackSub>(parameters);
+}
+
+TrackerBackSub::TrackerBackSub(const Params& parameters) : params(parameters) {
+	if (params.scale <= 0 || params.scale > 1) {
+		params.scale = 1;
+	}
+}
+
+void TrackerBackSub::init(InputArray image, const Rect&) {
+	// shadows are not the mouse, keep the mask binary
+	pBackSub = createBackgroundSubtractorMOG2(params.history, params.varThreshold, false);
+	if (params.openKernel > 0) {
+		kernel = getStructuringElement(MORPH_ELLIPSE, Size(params.openKernel, params.openKernel));
+	}
+	Mat frame = image.getMat();
+	resize(frame, scaled, Size(), params.scale, params.scale, INTER_AREA);
+	pBackSub->apply(scaled, fgMask, params.learningRate);
+}
+
+bool TrackerBackSub::update(InputArray image, Rect& boundingBox) {
+	Mat frame = image.getMat();
+	if (params.scale < 1) {
+		resize(frame, scaled, Size(), params.scale, params.scale, INTER_AREA);
+	} else {
+		scaled = frame;
+	}
+	pBackSub->apply(scaled, fgMask, params.learningRate);
+	if (kernel.empty()) {
+		mask = fgMask;
+	} else {
+		morphologyEx(fgMask, mask, MORPH_OPEN, kernel);
+	}
+
+	auto best = largestComponent(mask, labels, stats, centroids);
+	auto minArea = params.minArea * params.scale * params.scale;
+	if (best == 0 || stats.at<int>(best, CC_STAT_AREA) < minArea) {
+		return false;
+	}
+
+	// center the box on the centroid so the engine classifies the centroid
+	auto cx = centroids.at<double>(best, 0) / params.scale;
+	auto cy = centroids.at<double>(best, 1) / params.scale;
+	auto width = (int)(stats.at<int>(best, CC_STAT_WIDTH) / params.scale);
+	auto height = (int)(stats.at<int>(best, CC_STAT_HEIGHT) / params.scale);
+	boundingBox = Rect((int)cx - width / 2, (int)cy - height / 2, width, height);
+	return true;
+}
@@ -0,0 +1,41 @@
+// backSubTracker.h : follows the mouse as the largest foreground blob of a
+// MOG2 background model, a cheap alternative to the appearance trackers.
+//
+
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <opencv2/tracking.hpp>
+#include <opencv2/video/background_segm.hpp>
+
+// finds the largest 8-connected blob of a binary mask, returns false if it
+// is smaller than minArea pixels
+bool findLargestBlob(const cv::Mat& mask, cv::Rect& blob, cv::Point2f& centroid, int minArea);
+
+class TrackerBackSub : public cv::Tracker {
+public:
+	struct Params {
+		Params();
+		int history;					// MOG2 history
+		double varThreshold;			// MOG2 variance threshold
+		double learningRate;			// MOG2 learning rate, -1 picks it from history
+		double scale;					// frames are downscaled by this before subtraction
+		int openKernel;					// opening kernel removing speckle noise, 0 disables
+		int minArea;					// smallest blob accepted as the mouse, in full resolution pixels
+	};
+
+	static cv::Ptr<TrackerBackSub> create(const Params& parameters = Params());
+
+	void init(cv::InputArray image, const cv::Rect& boundingBox) override;
+	bool update(cv::InputArray image, cv::Rect& boundingBox) override;
+
+	// foreground mask of the last frame, at the downscaled size
+	const cv::Mat& foreground() const { return mask; }
+
+	explicit TrackerBackSub(const Params& parameters);
+
+private:
+	Params params;
+	cv::Ptr<cv::BackgroundSubtractorMOG2> pBackSub;
+	cv::Mat scaled, fgMask, mask, kernel, labels, stats, centroids;
+};
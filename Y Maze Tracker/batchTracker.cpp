@@ -0,0 +1,216 @@
+// batchTracker.cpp : Command line front end of the tracking engine, runs a
+// video headless and writes the zone counts and the trajectory.
+//
+
+#include "trackingEngine.h"
+#include "jobScheduler.h"
+#include "resultWriter.h"
+#include "checkpoint.h"
+#include "traceRecorder.h"
+#include "metricsServer.h"
+#include "allocCounter.h"
+#include "textFields.h"
+
+#include <opencv2/core/utility.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using namespace cv;
+using namespace std;
+
+const auto keys =
+	"{help h           |          | print this message }"
+	"{video v          |          | input video }"
+	"{triangle t       |          | vertices of the maze center, x1,y1,x2,y2,x3,y3 }"
+	"{bbox b           |          | mouse on the first frame, x,y,width,height }"
+	"{tracker          | CSRT     | GOTURN, CSRT, KCF, DaSiamRPN, MIL, BOOSTING, TLD, MEDIANFLOW, MOSSE, BACKSUB or MEDIANBG }"
+	"{preset           | balanced | fast, balanced, accurate or one from --presets }"
+	"{presets          |          | FileStorage file with more presets or overrides of the built in ones }"
+	"{backsub          |          | enable background subtraction }"
+	"{bg-samples       | 25       | frames sampled for the MEDIANBG background }"
+	"{reacquire        |          | re-init the tracker on the largest foreground blob after a failure }"
+	"{kalman           |          | track inside a Kalman predicted search window }"
+	"{entry-debounce   | 5        | frames the mouse must stay in an arm before the entry counts }"
+	"{decode-queue     | 8        | frames decoded ahead of the tracker, 0 decodes on the tracking thread }"
+	"{trajectory o     |          | write the per-frame trajectory to this csv file }"
+	"{trajectory-bin   |          | write the per-frame trajectory to this memory mappable binary file }"
+	"{checkpoint       |          | save the run to this file every --checkpoint-every frames }"
+	"{checkpoint-every | 1800     | frames between checkpoints }"
+	"{resume           |          | continue from --checkpoint if it exists, --triangle and --bbox are not needed then }"
+	"{results r        |          | stream per-frame results to this file while tracking, - for stdout }"
+	"{results-format   | csv      | csv or ndjson }"
+	"{annotated a      |          | encode the frames with the box, centroid and arm to this MJPG video }"
+	"{timings          |          | print the latency of each stage of the loop }"
+	"{timings-json     |          | write the stage latencies to this json file }"
+	"{trace            |          | write a Chrome trace of every stage and frame to this json file }"
+	"{metrics-port     |          | serve live counters at http://127.0.0.1:<port>/metrics, 0 picks a free port }"
+	"{jobs j           |          | run every session of this job list concurrently instead }"
+	"{threads          | 0        | cores used by --jobs, 0 uses all of them }";
+
+// timings, when given, gets the stage latencies of every job, trace their spans
+// and metrics their live counters
+int runJobList(const string& path, const TrackerPresets& presets, int cores, StageTimers* timings, shared_ptr<TraceRecorder> trace,
+	MetricsServer* metrics) {
+	vector<TrackingSession> jobs;
+	string error;
+	if (!loadJobs(path, jobs, presets, &error)) {
+		fprintf(stderr, "%s\n", error.c_str());
+		return 1;
+	}
+	for (auto& job : jobs) {
+		job.trace = trace;
+		if (metrics) {
+			job.metrics = make_shared<LiveMetrics>(job.videoPath, job.trackerType);
+			metrics->add(job.metrics);
+		}
+	}
+
+	mutex printMutex;
+	auto report = runBatch(jobs, cores, [&](const JobReport& job) {
+		lock_guard<mutex> lock(printMutex);
+		auto& video = jobs[job.index].videoPath;
+		if (!job.ok) {
+			fprintf(stderr, "%s: %s\n", video.c_str(), job.error.c_str());
+			return;
+		}
+		auto& result = job.result;
+		if (timings) {
+			timings->merge(result.timings);
+		}
+		printf("%s: center:%d, a:%d, b:%d, c:%d, entries:%d, alternation:%.1f%%, frames:%d, failures:%d, recovered frames:%d\n",
+			video.c_str(), result.in_center, result.a, result.b, result.c, result.behavior.armEntries,
+			result.behavior.alternationPercent(), result.frames, result.failures, result.recoveredFrames);
+		fflush(stdout);
+	});
+
+	auto failed = count_if(report.jobs.begin(), report.jobs.end(), [](const JobReport& job) { return !job.ok; });
+	printf("%zu jobs, %zu failed, %lld frames in %.1f s, %.1f fps\n", report.jobs.size(), (size_t)failed,
+		report.frames, report.seconds, report.fps());
+	return failed ? 1 : 0;
+}
+
+int main(int argc, char** argv) {
+	// streamed results survive ctrl+c and crashes
+	installCrashFlush();
+	// --timings reports the Mat buffers the loop allocates too, in a build
+	// configured with YMAZE_COUNT_ALLOCATIONS
+	installMatAllocationCounter();
+	CommandLineParser parser(argc, argv, keys);
+	parser.about("Y Maze Tracker batch mode");
+	if (parser.has("help")) {
+		parser.printMessage();
+		return 0;
+	}
+
+	TrackerPresets presets;
+	string error;
+	if (parser.has("presets") && !presets.load(parser.get<string>("presets"), &error)) {
+		fprintf(stderr, "%s\n", error.c_str());
+		return 1;
+	}
+
+	auto printTimings = parser.has("timings");
+	auto timingsPath = parser.get<string>("timings-json");
+	auto reportTimings = [&](const StageTimers& timings) {
+		if (printTimings) {
+			printf("%s", timings.summary().c_str());
+		}
+		if (!timingsPath.empty() && !timings.writeJson(timingsPath)) {
+			fprintf(stderr, "Could not write %s\n", timingsPath.c_str());
+			return false;
+		}
+		return true;
+	};
+
+	shared_ptr<TraceRecorder> trace;
+	auto tracePath = parser.get<string>("trace");
+	if (!tracePath.empty()) {
+		trace = make_shared<TraceRecorder>(tracePath);
+		if (!trace->isOpen()) {
+			fprintf(stderr, "Could not open %s for writing\n", tracePath.c_str());
+			return 1;
+		}
+		trace->nameThread("main");
+	}
+	unique_ptr<MetricsServer> metrics;
+	if (parser.has("metrics-port")) {
+		metrics = make_unique<MetricsServer>(parser.get<int>("metrics-port"));
+		if (!metrics->isOpen()) {
+			fprintf(stderr, "Could not listen on port %d\n", parser.get<int>("metrics-port"));
+			return 1;
+		}
+		fprintf(stderr, "metrics at http://127.0.0.1:%d/metrics\n", metrics->port());
+	}
+
+	if (parser.has("jobs")) {
+		StageTimers timings;
+		auto status = runJobList(parser.get<string>("jobs"), presets, parser.get<int>("threads"),
+			printTimings || !timingsPath.empty() ? &timings : nullptr, trace, metrics.get());
+		return reportTimings(timings) ? status : 1;
+	}
+
+	TrackingSession session;
+	session.videoPath = parser.get<string>("video");
+	session.trackerType = parser.get<string>("tracker");
+	auto preset = parser.get<string>("preset");
+	if (!presets.find(preset, session.trackerParams)) {
+		fprintf(stderr, "Unknown preset %s\n", preset.c_str());
+		return 1;
+	}
+	session.useBackSub = parser.has("backsub");
+	session.decodeQueue = parser.get<int>("decode-queue");
+	session.entryDebounce = parser.get<int>("entry-debounce");
+	session.backgroundSamples = parser.get<int>("bg-samples");
+	session.reacquire = parser.has("reacquire");
+	session.predictWindow = parser.has("kalman");
+	auto triangle = parseInts(parser.get<string>("triangle"));
+	auto bbox = parseInts(parser.get<string>("bbox"));
+	session.trajectoryPath = parser.get<string>("trajectory");
+	session.trajectoryBinPath = parser.get<string>("trajectory-bin");
+	session.checkpointPath = parser.get<string>("checkpoint");
+	session.checkpointInterval = parser.get<int>("checkpoint-every");
+	session.resume = parser.has("resume");
+	session.resultsPath = parser.get<string>("results");
+	session.resultsFormat = parser.get<string>("results-format");
+	session.annotatedPath = parser.get<string>("annotated");
+	session.trace = trace;
+	if (metrics) {
+		session.metrics = make_shared<LiveMetrics>(session.videoPath, session.trackerType);
+		metrics->add(session.metrics);
+	}
+	// the checkpoint carries the maze and the mouse
+	const bool resuming = session.resume && !session.checkpointPath.empty() && checkpointExists(session.checkpointPath);
+	if (!parser.check() || session.videoPath.empty() || (!resuming && (triangle.size() != 6 || bbox.size() != 4))) {
+		parser.printErrors();
+		parser.printMessage();
+		return 1;
+	}
+	if (triangle.size() == 6 && bbox.size() == 4) {
+		for (int i = 0; i < 3; i++) {
+			session.triangle[i] = Point(triangle[i * 2], triangle[i * 2 + 1]);
+		}
+		session.bbox = Rect(bbox[0], bbox[1], bbox[2], bbox[3]);
+	}
+
+	TrackingResult result;
+	if (!runTracking(session, result, nullptr, &error)) {
+		fprintf(stderr, "%s\n", error.c_str());
+		return 1;
+	}
+	printf("center:%d, a:%d, b:%d, c:%d\n", result.in_center, result.a, result.b, result.c);
+	auto& behavior = result.behavior;
+	printf("entries:%d %s, alternations:%d (%.1f%%), distance:%.0f px, speed:%.1f px/s mean, %.1f px/s max\n",
+		behavior.armEntries, behavior.entrySequence.c_str(), behavior.alternations, behavior.alternationPercent(),
+		behavior.distance, behavior.meanSpeed(), behavior.maxSpeed);
+	printf("frames:%d, failures:%d, reacquired:%d, recovered frames:%d, coasted frames:%d, %.1f fps\n", result.frames, result.failures,
+		result.reacquisitions, result.recoveredFrames, result.coastedFrames, result.seconds > 0 ? result.frames / result.seconds : 0.0);
+	if (printTimings && allocationsCounted()) {
+		printf("heap allocations in the classify and output stages: %lld\n", (long long)result.loopAllocations);
+	}
+	return reportTimings(result.timings) ? 0 : 1;
+}
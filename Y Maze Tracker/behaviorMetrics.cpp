@@ -0,0 +1,66 @@
+// behaviorMetrics.cpp : Arm entry state machine and running path sums.
+//
+
+#include "behaviorMetrics.h"
+#include "trackingEngine.h"
+
+#include <algorithm>
+
+using namespace cv;
+using namespace std;
+
+BehaviorMetrics::Params::Params() {
+	debounceFrames = 5;
+}
+
+BehaviorMetrics::BehaviorMetrics(const Params& parameters) : params(parameters) {
+	// room for the entries of a long session, so an entry never reallocates mid run
+	current.entrySequence.reserve(1024);
+}
+
+void BehaviorMetrics::update(const Rect& bbox, double timestamp, bool success, uint8_t zone) {
+	if (!success) {
+		// a lost frame breaks the path, the next tracked frame starts a new segment
+		havePrevious = false;
+		return;
+	}
+
+	auto center = Point2f(bbox.x + bbox.width * 0.5f, bbox.y + bbox.height * 0.5f);
+	if (havePrevious && timestamp > previousTimestamp) {
+		auto step = norm(center - previousCenter);
+		auto seconds = (timestamp - previousTimestamp) / 1000.0;
+		current.distance += step;
+		current.trackedSeconds += seconds;
+		current.maxSpeed = max(current.maxSpeed, step / seconds);
+	}
+	previousCenter = center;
+	previousTimestamp = timestamp;
+	havePrevious = true;
+
+	// a zone only counts once the box center stayed in it for debounceFrames,
+	// so jitter on a zone border does not produce entries
+	if (zone == ZONE_NONE || zone == location) {
+		candidate = location;
+		candidateFrames = 0;
+		return;
+	}
+	if (zone != candidate) {
+		candidate = zone;
+		candidateFrames = 0;
+	}
+	if (++candidateFrames < max(params.debounceFrames, 1)) {
+		return;
+	}
+	location = zone;
+	if (zone != ZONE_A && zone != ZONE_B && zone != ZONE_C) {
+		return;
+	}
+
+	current.armEntries += 1;
+	current.entrySequence += (char)('A' + (zone - ZONE_A));
+	if (current.armEntries > 2 && zone != lastArm && zone != olderArm && lastArm != olderArm) {
+		current.alternations += 1;
+	}
+	olderArm = lastArm;
+	lastArm = zone;
+}
@@ -0,0 +1,51 @@
+// behaviorMetrics.h : arm entries, spontaneous alternation, distance and speed
+// updated one frame at a time, so the report is final as soon as the last
+// frame is tracked.
+//
+
+#pragma once
+
+#include <opencv2/core.hpp>
+
+#include <cstdint>
+#include <string>
+
+struct BehaviorReport {
+	int armEntries = 0;
+	int alternations = 0;					// three consecutive entries into three different arms
+	std::string entrySequence;				// arms in the order they were entered, e.g. "ABCAB"
+	double distance = 0;					// path length of the box center in px
+	double trackedSeconds = 0;				// time covered by consecutive tracked frames
+	double maxSpeed = 0;					// px/s
+
+	// alternations over possible alternations (entries - 2), in percent
+	double alternationPercent() const { return armEntries > 2 ? 100.0 * alternations / (armEntries - 2) : 0.0; }
+	double meanSpeed() const { return trackedSeconds > 0 ? distance / trackedSeconds : 0.0; }
+};
+
+class BehaviorMetrics {
+public:
+	struct Params {
+		Params();
+		int debounceFrames;			// frames a zone must hold before it counts as entered
+	};
+
+	BehaviorMetrics(const Params& parameters = Params());
+
+	// zone is the Zone label of the frame, ignored when the tracker failed
+	void update(const cv::Rect& bbox, double timestamp, bool success, uint8_t zone);
+
+	const BehaviorReport& report() const { return current; }
+
+private:
+	Params params;
+	BehaviorReport current;
+	uint8_t location = 0;			// last debounced zone, 0 before the first one
+	uint8_t candidate = 0;			// zone waiting out the debounce
+	int candidateFrames = 0;
+	uint8_t olderArm = 0;			// the last two arms entered, for the alternation triplet
+	uint8_t lastArm = 0;
+	bool havePrevious = false;		// previous frame was tracked
+	cv::Point2f previousCenter;
+	double previousTimestamp = 0;
+};
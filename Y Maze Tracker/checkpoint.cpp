@@ -0,0 +1,199 @@
+// checkpoint.cpp : Checkpoint counters in a FileStorage yaml, the trajectory
+// in an append-only file of fixed size rows.
+//
+
+#include "checkpoint.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+using namespace cv;
+using namespace std;
+
+// one trajectory row of path.rows, in the layout of the build that wrote it
+struct CheckpointRow {
+	double timestamp;
+	int32_t frame, x, y, width, height;
+	uint8_t success, zone;
+};
+
+static string rowsPathOf(const string& path) {
+	return path + ".rows";
+}
+
+// rename replaces the target on Windows too, unlike std::rename
+static bool replaceFile(const string& from, const string& to) {
+	error_code ec;
+	filesystem::rename(filesystem::path(from), filesystem::path(to), ec);
+	return !ec;
+}
+
+CheckpointWriter::CheckpointWriter(const string& path, size_t keepRows) : path(path) {
+	auto rowsPath = rowsPathOf(path);
+	if (keepRows == 0) {
+		rows = fopen(rowsPath.c_str(), "wb");
+		return;
+	}
+	// rows past the checkpoint belong to a save the yaml never got
+	error_code ec;
+	filesystem::resize_file(filesystem::path(rowsPath), keepRows * sizeof(CheckpointRow), ec);
+	if (!ec) {
+		rows = fopen(rowsPath.c_str(), "r+b");
+		savedRows = keepRows;
+	}
+}
+
+CheckpointWriter::~CheckpointWriter() {
+	if (rows) {
+		fclose(rows);
+	}
+}
+
+bool CheckpointWriter::save(const Checkpoint& state, const TrackingResult& result) {
+	if (!rows) {
+		return false;
+	}
+	// the rows go first, a yaml always points at rows that are all written.
+	// A failed append is written again from the same place by the next save.
+	auto& t = result.trajectory;
+	vector<CheckpointRow> added(t.size() - min(savedRows, t.size()));
+	for (size_t i = 0; i < added.size(); i++) {
+		auto row = savedRows + i;
+		added[i] = { t.timestamp[row], t.frame[row], t.x[row], t.y[row], t.width[row], t.height[row], t.success[row], t.zone[row] };
+	}
+	if (fseek(rows, (long)(savedRows * sizeof(CheckpointRow)), SEEK_SET) != 0 ||
+		fwrite(added.data(), sizeof(CheckpointRow), added.size(), rows) != added.size() || fflush(rows) != 0) {
+		return false;
+	}
+	savedRows += added.size();
+
+	FileStorage fs(path + ".tmp", FileStorage::WRITE | FileStorage::FORMAT_YAML);
+	if (!fs.isOpened()) {
+		return false;
+	}
+	vector<int> triangle;
+	for (auto& vertex : state.triangle) {
+		triangle.push_back(vertex.x);
+		triangle.push_back(vertex.y);
+	}
+	fs << "video" << state.videoPath;
+	fs << "tracker" << state.trackerType;
+	fs << "preset" << state.preset;
+	fs << "backsub" << (int)state.useBackSub;
+	fs << "reacquire" << (int)state.reacquire;
+	fs << "kalman" << (int)state.predictWindow;
+	fs << "triangle" << triangle;
+	fs << "selection" << vector<int>{ state.selection.x, state.selection.y, state.selection.width, state.selection.height };
+	fs << "frame" << state.frame;
+	fs << "bbox" << vector<int>{ state.bbox.x, state.bbox.y, state.bbox.width, state.bbox.height };
+	fs << "reacquired" << (int)state.reacquired;
+	fs << "seconds" << state.seconds;
+	fs << "in_center" << result.in_center;
+	fs << "a" << result.a;
+	fs << "b" << result.b;
+	fs << "c" << result.c;
+	fs << "failures" << result.failures;
+	fs << "reacquisitions" << result.reacquisitions;
+	fs << "recovered_frames" << result.recoveredFrames;
+	fs << "coasted_frames" << state.coastedFrames;
+	fs.release();
+	return replaceFile(path + ".tmp", path);
+}
+
+bool loadCheckpoint(const string& path, Checkpoint& state, TrackingResult& result, string* error) {
+	auto fail = [error](const string& message) {
+		if (error) {
+			*error = message;
+		}
+		return false;
+	};
+
+	FileStorage fs;
+	try {
+		fs.open(path, FileStorage::READ);
+	} catch (const Exception& e) {
+		return fail("Could not parse checkpoint " + path + ": " + e.what());
+	}
+	if (!fs.isOpened()) {
+		return fail("Could not open checkpoint " + path);
+	}
+	vector<int> triangle, selection, bbox;
+	fs["video"] >> state.videoPath;
+	fs["tracker"] >> state.trackerType;
+	fs["preset"] >> state.preset;
+	state.useBackSub = (int)fs["backsub"] != 0;
+	state.reacquire = (int)fs["reacquire"] != 0;
+	state.predictWindow = (int)fs["kalman"] != 0;
+	fs["triangle"] >> triangle;
+	fs["selection"] >> selection;
+	fs["bbox"] >> bbox;
+	state.frame = (int)fs["frame"];
+	if (triangle.size() != 6 || selection.size() != 4 || bbox.size() != 4 || state.frame < 1) {
+		return fail("Checkpoint " + path + " is incomplete");
+	}
+	for (int i = 0; i < 3; i++) {
+		state.triangle[i] = Point(triangle[i * 2], triangle[i * 2 + 1]);
+	}
+	state.selection = Rect(selection[0], selection[1], selection[2], selection[3]);
+	state.bbox = Rect(bbox[0], bbox[1], bbox[2], bbox[3]);
+	state.reacquired = (int)fs["reacquired"] != 0;
+	state.seconds = (double)fs["seconds"];
+	state.coastedFrames = (int)fs["coasted_frames"];
+
+	result = TrackingResult();
+	result.in_center = (int)fs["in_center"];
+	result.a = (int)fs["a"];
+	result.b = (int)fs["b"];
+	result.c = (int)fs["c"];
+	result.failures = (int)fs["failures"];
+	result.reacquisitions = (int)fs["reacquisitions"];
+	result.recoveredFrames = (int)fs["recovered_frames"];
+	result.coastedFrames = state.coastedFrames;
+	result.seconds = state.seconds;
+	result.frames = state.frame;
+
+	auto file = fopen(rowsPathOf(path).c_str(), "rb");
+	if (!file) {
+		return fail("Could not open checkpoint trajectory " + rowsPathOf(path));
+	}
+	// a crash between the append and the rename leaves rows newer than the yaml
+	vector<CheckpointRow> rows(state.frame);
+	auto read = fread(rows.data(), sizeof(CheckpointRow), rows.size(), file);
+	fclose(file);
+	if (read < rows.size()) {
+		return fail("Checkpoint trajectory " + rowsPathOf(path) + " is shorter than the checkpoint");
+	}
+	result.trajectory.reserve(rows.size());
+	for (auto& row : rows) {
+		result.trajectory.append(row.frame, row.timestamp, Rect(row.x, row.y, row.width, row.height), row.success != 0, row.zone);
+	}
+	return true;
+}
+
+string checkpointMismatch(const Checkpoint& state, const TrackingSession& session) {
+	string differing;
+	auto check = [&differing](bool same, const char* name) {
+		if (!same) {
+			differing += differing.empty() ? name : string(", ") + name;
+		}
+	};
+	check(state.videoPath == session.videoPath, "video");
+	check(state.trackerType == session.trackerType, "tracker");
+	check(state.preset == session.trackerParams.fingerprint(), "preset");
+	check(state.useBackSub == session.useBackSub, "backsub");
+	check(state.reacquire == session.reacquire, "reacquire");
+	check(state.predictWindow == session.predictWindow, "kalman");
+	return differing;
+}
+
+bool checkpointExists(const string& path) {
+	error_code ec;
+	return filesystem::exists(filesystem::path(path), ec);
+}
+
+void removeCheckpoint(const string& path) {
+	error_code ec;
+	filesystem::remove(filesystem::path(path), ec);
+	filesystem::remove(filesystem::path(rowsPathOf(path)), ec);
+}
@@ -0,0 +1,62 @@
+// checkpoint.h : snapshot of a running session, so a long recording that is
+// interrupted continues from the last checkpoint instead of frame 1.
+//
+
+#pragma once
+
+#include "trackingEngine.h"
+
+#include <opencv2/core.hpp>
+
+#include <array>
+#include <cstdio>
+#include <string>
+
+// the trackers cannot serialize their models, a resumed run re-initializes
+// the tracker on the box of the checkpointed frame
+struct Checkpoint {
+	std::string videoPath;
+	std::string trackerType;
+	std::string preset;						// TrackerPreset::fingerprint() of the tracker parameters
+	bool useBackSub = false;				// settings of the session that saved it, a resume needs the same
+	bool reacquire = false;
+	bool predictWindow = false;
+	std::array<cv::Point, 3> triangle;
+	cv::Rect selection;						// box selected on the first frame, sizes re-acquisitions
+	int frame = 0;							// last tracked frame, the run continues after it
+	cv::Rect bbox;							// box on that frame
+	bool reacquired = false;				// tracker was re-initialized on a blob and has not failed since
+	double seconds = 0;						// tracking time so far, including earlier resumed runs
+	int coastedFrames = 0;					// Kalman coasted frames so far
+};
+
+// saves the checkpoints of one run. The trajectory rows added since the
+// previous save are appended to path.rows, then the yaml at path is replaced
+// through a temporary file, so a save costs the new rows rather than the
+// whole run and an interrupted save keeps the previous checkpoint
+class CheckpointWriter {
+public:
+	// the first keepRows rows of an existing path.rows are kept, a resumed
+	// run passes the length of its restored trajectory
+	explicit CheckpointWriter(const std::string& path, size_t keepRows = 0);
+	~CheckpointWriter();
+	CheckpointWriter(const CheckpointWriter&) = delete;
+	CheckpointWriter& operator=(const CheckpointWriter&) = delete;
+
+	bool isOpen() const { return rows != nullptr; }
+	bool save(const Checkpoint& state, const TrackingResult& result);
+
+private:
+	std::string path;
+	FILE* rows = nullptr;
+	size_t savedRows = 0;					// trajectory rows already in path.rows
+};
+
+// result gets the counters and the trajectory up to state.frame
+bool loadCheckpoint(const std::string& path, Checkpoint& state, TrackingResult& result, std::string* error = nullptr);
+// names the settings of session that differ from the ones state was saved
+// with, empty if the session can continue it
+std::string checkpointMismatch(const Checkpoint& state, const TrackingSession& session);
+bool checkpointExists(const std::string& path);
+// the writer of the checkpoint must be closed first
+void removeCheckpoint(const std::string& path);
@@ -41,6 +41,7 @@
 
 #include "cvHighGUI.h"
 #include "resource.h"
+#include "showConvert.h"
 
 #include <opencv2/core/utils/logger.hpp>
 #include <opencv2/core/utils/trace.hpp>
@@ -1224,12 +1225,8 @@ static void showImage_(CvWindow& window, const Mat& image) {
         );
     }
 
-    {
-        cv::Mat dst(size.cy, size.cx, CV_8UC3, dst_ptr, (size.cx * channels + 3) & -4);
-        convertToShow(image, dst, false);
-        CV_Assert(dst.data == (uchar*)dst_ptr);
-        cv::flip(dst, dst, 0);
-    }
+    // converted straight into the bottom-up rows of the DIB, no second flip pass
+    convertToShowFlipped(image, (uchar*)dst_ptr, (size.cx * channels + 3) & -4);
 
     // only resize window if needed
     if (changed_size)
@@ -0,0 +1,370 @@
+// engineTests.cpp : Checks of the engine on small fixtures and generated
+// clips, one ctest case per argument.
+//
+
+#include "trackingEngine.h"
+#include "zoneMap.h"
+#include "behaviorMetrics.h"
+#include "trajectoryFile.h"
+#include "checkpoint.h"
+#include "evaluation.h"
+#include "syntheticMaze.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <vector>
+
+using namespace cv;
+using namespace std;
+
+// ctest counts this exit code as skipped
+const int skipped = 77;
+
+static int failures = 0;
+
+static void expect(bool condition, const string& what) {
+	if (!condition) {
+		fprintf(stderr, "failed: %s\n", what.c_str());
+		failures += 1;
+	}
+}
+
+// a folder of its own under the temp directory, emptied first
+static filesystem::path scratch(const string& name) {
+	auto path = filesystem::temp_directory_path() / ("ymaze_tests_" + name);
+	error_code ec;
+	filesystem::remove_all(path, ec);
+	filesystem::create_directories(path, ec);
+	return path;
+}
+
+static string describe(const array<Point, 3>& t) {
+	char text[96];
+	snprintf(text, sizeof(text), "(%d,%d) (%d,%d) (%d,%d)", t[0].x, t[0].y, t[1].x, t[1].y, t[2].x, t[2].y);
+	return text;
+}
+
+// a point well inside the arm that opens from each edge
+static array<Point, 3> armProbes(const array<Point, 3>& t) {
+	auto center = Point2f((t[0].x + t[1].x + t[2].x) / 3.f, (t[0].y + t[1].y + t[2].y) / 3.f);
+	array<Point, 3> probes;
+	for (auto i = 0; i < 3; i++) {
+		auto mid = Point2f((t[i].x + t[(i + 1) % 3].x) / 2.f, (t[i].y + t[(i + 1) % 3].y) / 2.f);
+		auto direction = mid - center;
+		direction *= 1.f / (float)norm(direction);
+		probes[i] = Point(center + direction * 120.f);
+	}
+	return probes;
+}
+
+// every orientation gets a center and three distinct arms, whatever order the
+// vertices were clicked in; the lowest arm is c and the right one of the
+// other two is b, two equally low arms are taken left to right
+static void checkZoneNames(const Size& size, const array<Point, 3>& triangle) {
+	auto probes = armProbes(triangle);
+	ZoneMap zones(size, triangle);
+	auto name = describe(triangle);
+	auto centroid = Point((triangle[0].x + triangle[1].x + triangle[2].x) / 3, (triangle[0].y + triangle[1].y + triangle[2].y) / 3);
+	expect(zones.classify(centroid) == ZONE_CENTER, name + ": centroid is not the center");
+
+	array<Zone, 3> labels;
+	for (auto i = 0; i < 3; i++) {
+		labels[i] = zones.classify(probes[i]);
+	}
+	auto sorted = labels;
+	sort(sorted.begin(), sorted.end());
+	expect(sorted == array<Zone, 3>{ ZONE_A, ZONE_B, ZONE_C }, name + ": the arms are not a, b and c");
+
+	array<int, 3> order = { 0, 1, 2 };
+	sort(order.begin(), order.end(), [&](int l, int r) {
+		return probes[l].y != probes[r].y ? probes[l].y > probes[r].y : probes[l].x < probes[r].x;
+	});
+	// rounding decides a near tie, the permutations below still cover it
+	if (abs(probes[order[0]].y - probes[order[1]].y) > 1) {
+		expect(labels[order[0]] == ZONE_C, name + ": the lowest arm is not c");
+		auto right = probes[order[1]].x > probes[order[2]].x ? order[1] : order[2];
+		expect(labels[right] == ZONE_B, name + ": the right arm is not b");
+	}
+
+	array<int, 3> permutation = { 0, 1, 2 };
+	do {
+		array<Point, 3> reordered;
+		for (auto i = 0; i < 3; i++) {
+			reordered[i] = triangle[permutation[i]];
+		}
+		ZoneMap other(size, reordered);
+		for (auto i = 0; i < 3; i++) {
+			expect(other.classify(probes[i]) == labels[i], name + ": the names change with the order as " + describe(reordered));
+		}
+	} while (next_permutation(permutation.begin(), permutation.end()));
+}
+
+static void testZones() {
+	const Size size(640, 480);
+	const Point2f center(320, 240);
+	for (auto degrees = 0; degrees < 360; degrees += 15) {
+		array<Point, 3> triangle, mirrored;
+		for (auto i = 0; i < 3; i++) {
+			auto angle = (degrees + 90 + i * 120) * CV_PI / 180;
+			triangle[i] = Point(center + Point2f((float)cos(angle), (float)sin(angle)) * 40.f);
+			mirrored[i] = Point(size.width - 1 - triangle[i].x, triangle[i].y);
+		}
+		checkZoneNames(size, triangle);
+		checkZoneNames(size, mirrored);
+	}
+	// the synthetic maze: one arm up, two equally far down
+	array<Point, 3> triangle = { Point(290, 220), Point(350, 220), Point(320, 272) };
+	checkZoneNames(size, triangle);
+	ZoneMap zones(size, triangle);
+	expect(zones.classify(Point(320, 100)) == ZONE_A, "the arm up is not a");
+	expect(zones.classify(Point(220, 320)) == ZONE_C, "the arm down left is not c");
+	expect(zones.classify(Point(420, 320)) == ZONE_B, "the arm down right is not b");
+}
+
+static void testBehavior() {
+	BehaviorMetrics::Params params;
+	params.debounceFrames = 3;
+	BehaviorMetrics behavior(params);
+	auto frame = 0;
+	// the box moves 2 px every 100 ms
+	auto feed = [&](uint8_t zone, int frames, bool success = true) {
+		for (auto i = 0; i < frames; i++, frame++) {
+			behavior.update(Rect(frame * 2, 50, 10, 10), frame * 100.0, success, zone);
+		}
+	};
+	feed(ZONE_A, 3);
+	feed(ZONE_CENTER, 3);
+	// shorter than the debounce, no entry
+	feed(ZONE_B, 2);
+	feed(ZONE_CENTER, 1);
+	feed(ZONE_B, 3);
+	feed(ZONE_C, 3);
+	feed(ZONE_A, 3);
+	feed(ZONE_CENTER, 3);
+	feed(ZONE_A, 3);
+	// a lost frame neither counts nor resets the debounce
+	feed(ZONE_B, 1);
+	feed(ZONE_B, 1, false);
+	feed(ZONE_B, 2);
+
+	auto& report = behavior.report();
+	expect(report.entrySequence == "ABCAAB", "entries " + report.entrySequence + " instead of ABCAAB");
+	expect(report.armEntries == 6, "arm entries " + to_string(report.armEntries) + " instead of 6");
+	// ABC and BCA alternate, CAA, AAB do not
+	expect(report.alternations == 2, "alternations " + to_string(report.alternations) + " instead of 2");
+	expect(report.alternationPercent() == 50, "alternation " + to_string(report.alternationPercent()) + "% instead of 50%");
+	// 27 tracked frames in runs of 25 and 2, the step across the loss is not walked
+	expect(abs(report.distance - 50) < 1e-9, "distance " + to_string(report.distance) + " instead of 50");
+	expect(abs(report.meanSpeed() - 20) < 1e-9 && abs(report.maxSpeed - 20) < 1e-9, "speed is not 20 px/s");
+}
+
+static bool sameTrajectory(const Trajectory& a, const Trajectory& b) {
+	return a.frame == b.frame && a.timestamp == b.timestamp && a.x == b.x && a.y == b.y && a.width == b.width &&
+		a.height == b.height && a.success == b.success && a.zone == b.zone;
+}
+
+static vector<char> readBytes(const filesystem::path& path) {
+	ifstream file(path, ios::binary);
+	return vector<char>(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+}
+
+static void writeBytes(const filesystem::path& path, const vector<char>& bytes) {
+	ofstream(path, ios::binary).write(bytes.data(), bytes.size());
+}
+
+static void testTrajectoryFile() {
+	auto folder = scratch("trajectory_file");
+	// frames 10 to 14 are missing
+	Trajectory trajectory;
+	for (auto frame = 1; frame <= 30; frame++) {
+		if (frame < 10 || frame > 14) {
+			trajectory.append(frame, frame * 33.367, Rect(frame * 3, 200 - frame, 20 + frame % 4, 18), frame % 5 != 0, frame % 5);
+		}
+	}
+	const array<Point, 3> triangle = { Point(290, 220), Point(350, 220), Point(320, 272) };
+	auto path = (folder / "run.ymt").string();
+	expect(writeTrajectoryFile(path, trajectory, triangle, "CSRT"), "could not write " + path);
+
+	string error;
+	{
+		TrajectoryFile file;
+		expect(file.open(path, &error), "could not open " + path + ": " + error);
+		if (file.rows() == trajectory.size()) {
+			Trajectory read;
+			file.read(read);
+			expect(sameTrajectory(read, trajectory), "the columns read back differ");
+			expect(file.trackerType() == "CSRT", "tracker " + file.trackerType() + " instead of CSRT");
+			expect(file.triangle() == triangle, "the triangle read back differs");
+			for (size_t i = 0; i < trajectory.size(); i++) {
+				expect(file.rowOf(trajectory.frame[i]) == (int64_t)i, "wrong row of frame " + to_string(trajectory.frame[i]));
+				expect(file.centerX()[i] == trajectory.x[i] + trajectory.width[i] / 2.f, "wrong center of row " + to_string(i));
+			}
+			for (auto frame : { 0, 10, 12, 14, 31 }) {
+				expect(file.rowOf(frame) == -1, "frame " + to_string(frame) + " is not missing");
+			}
+		} else {
+			expect(false, to_string(file.rows()) + " rows instead of " + to_string(trajectory.size()));
+		}
+	}
+
+	// damaged copies have to be refused at open, rowOf() trusts the index
+	auto bytes = readBytes(path);
+	TrajectoryFileHeader header;
+	memcpy(&header, bytes.data(), sizeof(header));
+	auto refused = [&](const string& what, const function<void(vector<char>&)>& damage) {
+		auto copy = bytes;
+		damage(copy);
+		auto damaged = (folder / "damaged.ymt").string();
+		writeBytes(damaged, copy);
+		TrajectoryFile file;
+		expect(!file.open(damaged), "a file with " + what + " was opened");
+	};
+	refused("an index entry past the last row", [&](vector<char>& b) {
+		int32_t entry = (int32_t)header.rows + 5;
+		memcpy(b.data() + header.indexOffset, &entry, sizeof(entry));
+	});
+	refused("an index entry below -1", [&](vector<char>& b) {
+		int32_t entry = -7;
+		memcpy(b.data() + header.indexOffset + sizeof(int32_t), &entry, sizeof(entry));
+	});
+	refused("an index shorter than its frame range", [&](vector<char>& b) {
+		auto h = header;
+		h.indexCount -= 1;
+		memcpy(b.data(), &h, sizeof(h));
+	});
+	refused("a missing tail", [&](vector<char>& b) {
+		b.resize(b.size() - 1);
+	});
+	refused("another magic", [&](vector<char>& b) {
+		b[0] = 'X';
+	});
+	error_code ec;
+	filesystem::remove_all(folder, ec);
+}
+
+static void testEvaluation() {
+	Trajectory truth, tracked;
+	truth.append(1, 0, Rect(100, 100, 20, 20), true, ZONE_A);
+	truth.append(2, 33, Rect(100, 100, 20, 20), true, ZONE_A);
+	truth.append(3, 67, Rect(100, 100, 20, 20), true, ZONE_A);
+	truth.append(4, 100, Rect(100, 100, 20, 20), true, ZONE_A);
+	// frame 6 has no truth, frame 5 nothing tracked
+	truth.append(5, 133, Rect(100, 100, 20, 20), true, ZONE_A);
+	tracked.append(1, 0, Rect(100, 100, 20, 20), true, ZONE_A);
+	// half a box to the right, IoU 1/3
+	tracked.append(2, 33, Rect(110, 100, 20, 20), true, ZONE_A);
+	tracked.append(3, 67, Rect(0, 0, 0, 0), false, ZONE_NONE);
+	tracked.append(4, 100, Rect(100, 100, 20, 20), true, ZONE_B);
+	tracked.append(6, 167, Rect(100, 100, 20, 20), true, ZONE_A);
+
+	auto a = compareTrajectories(tracked, truth);
+	expect(a.frames == 4, "compared " + to_string(a.frames) + " frames instead of 4");
+	expect(a.tracked == 3 && a.failures() == 1, "tracked " + to_string(a.tracked) + " frames instead of 3");
+	expect(abs(a.meanIoU() - (1 + 1 / 3. + 0 + 1) / 4) < 1e-9, "mean IoU " + to_string(a.meanIoU()));
+	expect(a.successRate() == 0.5, "success rate " + to_string(a.successRate()) + " instead of 0.5");
+	expect(abs(a.meanCenterError() - 10 / 3.) < 1e-9 && a.maxCenterError == 10, "center error is not 10 / 3 mean, 10 max");
+	expect(a.zoneAgreement() == 0.5, "zone agreement " + to_string(a.zoneAgreement()) + " instead of 0.5");
+
+	auto both = a;
+	both += a;
+	expect(both.frames == 8 && both.zoneMatches == 4 && both.maxCenterError == 10, "the sum of two clips is wrong");
+}
+
+// interrupted at a frame, resumed from its checkpoint, the run has to end
+// with the trajectory of a run that went through. MEDIANBG finds the mouse
+// on each frame alone, so re-initializing it at the checkpoint changes nothing
+static int testCheckpoint() {
+	auto folder = scratch("checkpoint");
+	SyntheticMaze::Params params;
+	params.frames = 90;
+	params.path = "ABCA";
+	auto video = (folder / "clip.avi").string();
+	string error;
+	if (!writeSyntheticVideo(params, video, "", "", &error)) {
+		fprintf(stderr, "skipped, no video writer: %s\n", error.c_str());
+		return skipped;
+	}
+
+	TrackingSession session;
+	session.videoPath = video;
+	session.triangle = params.triangle;
+	session.bbox = SyntheticMaze(params).firstBox();
+	session.trackerType = "MEDIANBG";
+	TrackingResult straight;
+	expect(runTracking(session, straight, nullptr, &error), "the straight run failed: " + error);
+
+	session.checkpointPath = (folder / "run.ckpt").string();
+	session.checkpointInterval = 20;
+	session.resultsPath = (folder / "run.csv").string();
+	const int stopAt = 47;
+	TrackingResult first;
+	expect(runTracking(session, first, [&](const FrameInfo& info) { return info.frame < stopAt; }, &error),
+		"the interrupted run failed: " + error);
+	expect(first.frames == stopAt, "the interrupted run stopped at " + to_string(first.frames));
+	expect(checkpointExists(session.checkpointPath), "the interrupted run left no checkpoint");
+
+	session.resume = true;
+	auto other = session;
+	other.useBackSub = true;
+	TrackingResult refused;
+	expect(!runTracking(other, refused, nullptr, &error), "a checkpoint was resumed with other settings");
+
+	TrackingResult resumed;
+	expect(runTracking(session, resumed, nullptr, &error), "the resumed run failed: " + error);
+	expect(sameTrajectory(resumed.trajectory, straight.trajectory), "the resumed trajectory differs from the straight one");
+	expect(resumed.frames == straight.frames && resumed.failures == straight.failures && resumed.in_center == straight.in_center &&
+		resumed.a == straight.a && resumed.b == straight.b && resumed.c == straight.c, "the resumed counters differ");
+	expect(resumed.behavior.entrySequence == straight.behavior.entrySequence, "the resumed arm entries differ");
+	expect(!checkpointExists(session.checkpointPath), "the finished run kept its checkpoint");
+
+	// the streamed results hold every frame once, the earlier run's included
+	ifstream results(session.resultsPath);
+	string line;
+	getline(results, line);
+	auto rows = 0;
+	while (getline(results, line)) {
+		rows += 1;
+		if (atoi(line.c_str()) != rows) {
+			expect(false, "results row " + to_string(rows) + " is frame " + line);
+			break;
+		}
+	}
+	expect(rows == straight.frames, "the results hold " + to_string(rows) + " rows instead of " + to_string(straight.frames));
+	results.close();
+	error_code ec;
+	filesystem::remove_all(folder, ec);
+	return 0;
+}
+
+int main(int argc, char** argv) {
+	const pair<const char*, function<int()>> tests[] = {
+		{ "zones", [] { testZones(); return 0; } },
+		{ "behavior", [] { testBehavior(); return 0; } },
+		{ "trajectory_file", [] { testTrajectoryFile(); return 0; } },
+		{ "evaluation", [] { testEvaluation(); return 0; } },
+		{ "checkpoint", testCheckpoint },
+	};
+	// no argument runs them all
+	auto ran = false, allSkipped = true;
+	for (auto& [name, test] : tests) {
+		if (argc > 1 && strcmp(argv[1], name) != 0) {
+			continue;
+		}
+		ran = true;
+		auto before = failures;
+		auto status = test();
+		allSkipped &= status == skipped;
+		fprintf(stderr, "%s: %s\n", name, failures > before ? "failed" : status == skipped ? "skipped" : "passed");
+	}
+	if (!ran) {
+		fprintf(stderr, "Unknown test %s\n", argv[1]);
+		return 1;
+	}
+	return failures ? 1 : allSkipped ? skipped : 0;
+}
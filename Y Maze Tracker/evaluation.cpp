@@ -0,0 +1,78 @@
+// evaluation.cpp : Frame by frame comparison of two trajectories.
+//
+
+#include "evaluation.h"
+#include "trajectoryFile.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+using namespace cv;
+using namespace std;
+
+Accuracy& Accuracy::operator+=(const Accuracy& other) {
+	frames += other.frames;
+	tracked += other.tracked;
+	iouSum += other.iouSum;
+	iouHits += other.iouHits;
+	centerErrorSum += other.centerErrorSum;
+	maxCenterError = max(maxCenterError, other.maxCenterError);
+	zoneMatches += other.zoneMatches;
+	return *this;
+}
+
+Accuracy compareTrajectories(const Trajectory& tracked, const Trajectory& truth) {
+	// frame number -> tracked row, both are usually 1..n but need not be
+	auto lastFrame = tracked.empty() ? 0 : *max_element(tracked.frame.begin(), tracked.frame.end());
+	vector<int> rowOf(max(lastFrame, 0) + 1, -1);
+	for (size_t i = 0; i < tracked.size(); i++) {
+		if (tracked.frame[i] >= 0) {
+			rowOf[tracked.frame[i]] = (int)i;
+		}
+	}
+
+	Accuracy accuracy;
+	for (size_t i = 0; i < truth.size(); i++) {
+		auto frame = truth.frame[i];
+		if (frame < 0 || frame > lastFrame || rowOf[frame] < 0) {
+			continue;
+		}
+		auto row = rowOf[frame];
+		accuracy.frames += 1;
+		if (!tracked.success[row]) {
+			continue;
+		}
+		accuracy.tracked += 1;
+		auto box = Rect(tracked.x[row], tracked.y[row], tracked.width[row], tracked.height[row]);
+		auto truthBox = Rect(truth.x[i], truth.y[i], truth.width[i], truth.height[i]);
+		auto overlap = (box & truthBox).area();
+		auto iou = overlap > 0 ? (double)overlap / (box.area() + truthBox.area() - overlap) : 0.0;
+		accuracy.iouSum += iou;
+		accuracy.iouHits += iou >= 0.5;
+		auto error = hypot((box.x + box.width * 0.5) - (truthBox.x + truthBox.width * 0.5),
+			(box.y + box.height * 0.5) - (truthBox.y + truthBox.height * 0.5));
+		accuracy.centerErrorSum += error;
+		accuracy.maxCenterError = max(accuracy.maxCenterError, error);
+		accuracy.zoneMatches += tracked.zone[row] == truth.zone[i];
+	}
+	return accuracy;
+}
+
+bool readTrajectory(const string& path, Trajectory& trajectory, string* error) {
+	if (path.size() >= 4 && path.compare(path.size() - 4, 4, ".ymt") == 0) {
+		TrajectoryFile file;
+		if (!file.open(path, error)) {
+			return false;
+		}
+		file.read(trajectory);
+		return true;
+	}
+	if (!trajectory.readCsv(path)) {
+		if (error) {
+			*error = "Could not read the trajectory " + path;
+		}
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,34 @@
+// evaluation.h : accuracy of a tracked trajectory against a ground truth
+// one, so every speed optimization comes with its accuracy cost.
+//
+
+#pragma once
+
+#include "trajectory.h"
+
+#include <string>
+
+struct Accuracy {
+	int frames = 0;							// truth frames compared
+	int tracked = 0;						// of those, frames the tracker reported a box for
+	double iouSum = 0;						// failed frames count as 0
+	int iouHits = 0;						// frames with IoU >= 0.5
+	double centerErrorSum = 0;				// px, tracked frames only
+	double maxCenterError = 0;
+	int zoneMatches = 0;					// same zone as the truth, failed frames never match
+
+	double meanIoU() const { return frames ? iouSum / frames : 0.0; }
+	double successRate() const { return frames ? (double)iouHits / frames : 0.0; }
+	double meanCenterError() const { return tracked ? centerErrorSum / tracked : 0.0; }
+	double zoneAgreement() const { return frames ? (double)zoneMatches / frames : 0.0; }
+	int failures() const { return frames - tracked; }
+
+	// sums, for an aggregate over several clips
+	Accuracy& operator+=(const Accuracy& other);
+};
+
+// compares the frames present in both, matched by frame number
+Accuracy compareTrajectories(const Trajectory& tracked, const Trajectory& truth);
+
+// a .ymt file or a csv written by Trajectory::writeCsv
+bool readTrajectory(const std::string& path, Trajectory& trajectory, std::string* error = nullptr);
@@ -0,0 +1,110 @@
+// frameDecoder.cpp : Producer / consumer ring between cap >> src and the
+// tracking loop.
+//
+
+#include "frameDecoder.h"
+#include "traceRecorder.h"
+
+using namespace cv;
+using namespace std;
+
+FrameDecoder::FrameDecoder(VideoCapture& cap, size_t capacity, TraceRecorder* trace)
+	: cap(cap), trace(trace), slots(max<size_t>(capacity, 1)), async(capacity > 0) {
+	// preallocate every slot so cap >> image decodes in place
+	auto width = (int)cap.get(CAP_PROP_FRAME_WIDTH);
+	auto height = (int)cap.get(CAP_PROP_FRAME_HEIGHT);
+	if (width > 0 && height > 0) {
+		for (auto& slot : slots) {
+			slot.image.create(height, width, CV_8UC3);
+		}
+	}
+	if (async) {
+		worker = thread(&FrameDecoder::decodeLoop, this);
+	}
+}
+
+FrameDecoder::~FrameDecoder() {
+	if (worker.joinable()) {
+		{
+			lock_guard<mutex> lock(ringMutex);
+			stopping = true;
+		}
+		notFull.notify_all();
+		worker.join();
+	}
+}
+
+bool FrameDecoder::read(FrameSlot& slot) {
+	auto start = trace ? getTickCount() : 0;
+	auto ok = cap.read(slot.image) && !slot.image.empty();
+	if (ok) {
+		slot.timestamp = cap.get(CAP_PROP_POS_MSEC);
+	}
+	if (trace) {
+		trace->span("read", start, getTickCount());
+	}
+	return ok;
+}
+
+const FrameSlot* FrameDecoder::next() {
+	if (!async) {
+		auto& slot = slots[0];
+		if (finished || !read(slot)) {
+			finished = true;
+			return nullptr;
+		}
+		return &slot;
+	}
+
+	unique_lock<mutex> lock(ringMutex);
+	if (holding) {
+		head = (head + 1) % slots.size();
+		count -= 1;
+		holding = false;
+		notFull.notify_one();
+	}
+	notEmpty.wait(lock, [this] { return count > 0 || finished; });
+	if (count == 0) {
+		return nullptr;
+	}
+	holding = true;
+	return &slots[head];
+}
+
+size_t FrameDecoder::queued() {
+	if (!async) {
+		return 0;
+	}
+	lock_guard<mutex> lock(ringMutex);
+	return holding ? count - 1 : count;
+}
+
+void FrameDecoder::decodeLoop() {
+	if (trace) {
+		trace->nameThread("decoder");
+	}
+	for (;;) {
+		size_t index;
+		{
+			unique_lock<mutex> lock(ringMutex);
+			notFull.wait(lock, [this] { return stopping || count < slots.size(); });
+			if (stopping) {
+				break;
+			}
+			index = tail;
+		}
+
+		// the slot at tail is not visible to the consumer, decode without the lock
+		auto ok = read(slots[index]);
+
+		lock_guard<mutex> lock(ringMutex);
+		if (!ok) {
+			finished = true;
+			notEmpty.notify_one();
+			break;
+		}
+		tail = (tail + 1) % slots.size();
+		count += 1;
+		notEmpty.notify_one();
+	}
+}
@@ -0,0 +1,54 @@
+// frameDecoder.h : decodes a video into a bounded ring of preallocated frames
+// on a background thread, so decoding overlaps with tracker->update.
+//
+
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <opencv2/videoio.hpp>
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class TraceRecorder;
+
+struct FrameSlot {
+	cv::Mat image;
+	double timestamp = 0;	// position in the video in ms
+};
+
+class FrameDecoder {
+public:
+	// capacity 0 decodes synchronously inside next() without a thread, every
+	// cap.read is a "read" span of trace when given
+	FrameDecoder(cv::VideoCapture& cap, size_t capacity, TraceRecorder* trace = nullptr);
+	~FrameDecoder();
+	FrameDecoder(const FrameDecoder&) = delete;
+	FrameDecoder& operator=(const FrameDecoder&) = delete;
+
+	// hands out the next decoded frame and gives the previous one back to the
+	// decoder, returns nullptr at the end of the video
+	const FrameSlot* next();
+	// frames decoded and not handed out yet
+	size_t queued();
+
+private:
+	void decodeLoop();
+	bool read(FrameSlot& slot);
+
+	cv::VideoCapture& cap;
+	TraceRecorder* trace;
+	std::vector<FrameSlot> slots;
+	const bool async;
+	size_t head = 0;		// oldest decoded slot, owned by the consumer while holding
+	size_t tail = 0;		// next slot to decode into
+	size_t count = 0;		// decoded slots, including the one being held
+	bool holding = false;
+	bool finished = false;
+	bool stopping = false;
+	std::mutex ringMutex;
+	std::condition_variable notEmpty, notFull;
+	std::thread worker;
+};
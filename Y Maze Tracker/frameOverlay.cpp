@@ -0,0 +1,72 @@
+// frameOverlay.cpp : Glyph masks and the annotation layout of the preview.
+//
+
+#include "frameOverlay.h"
+
+#include <opencv2/imgproc.hpp>
+
+#include <cstdio>
+
+using namespace cv;
+using namespace std;
+
+OverlayFont::OverlayFont(int fontFace, double fontScale, int thickness) {
+	int baseline = 0;
+	auto height = getTextSize("Ag|", fontFace, fontScale, thickness, &baseline).height;
+	// strokes reach past the advance and the text height by about the thickness
+	auto pad = thickness + 2;
+	offset = Point(pad, pad + height);
+	for (auto c = FIRST; c <= LAST; c++) {
+		char text[2] = { (char)c, 0 };
+		advance[c - FIRST] = getTextSize(text, fontFace, fontScale, thickness, &baseline).width;
+		auto& glyph = glyphs[c - FIRST];
+		glyph = Mat::zeros(height + baseline + 2 * pad, advance[c - FIRST] + 2 * pad, CV_8UC1);
+		putText(glyph, text, offset, fontFace, fontScale, Scalar(255), thickness);
+	}
+}
+
+void OverlayFont::draw(Mat& image, const char* text, Point origin, const Scalar& color) const {
+	const auto bounds = Rect(0, 0, image.cols, image.rows);
+	for (; *text; text++) {
+		auto c = (unsigned char)*text;
+		if (c < FIRST || c > LAST) {
+			c = '?';
+		}
+		auto& glyph = glyphs[c - FIRST];
+		auto area = Rect(origin - offset, glyph.size());
+		auto visible = area & bounds;
+		if (!visible.empty()) {
+			image(visible).setTo(color, glyph(Rect(visible.tl() - area.tl(), visible.size())));
+		}
+		origin.x += advance[c - FIRST];
+	}
+}
+
+FrameOverlay::FrameOverlay(const string& trackerType)
+	: titleFont(FONT_HERSHEY_COMPLEX, 0.75, 2), lineFont(FONT_HERSHEY_PLAIN, 1.2, 1) {
+	snprintf(trackerLabel, sizeof(trackerLabel), "%s Tracker", trackerType.c_str());
+}
+
+void FrameOverlay::draw(Mat& image, int frame, const Rect& bbox, bool success, Zone zone) const {
+	if (success) {
+		// Tracking success
+		auto p1 = Point(bbox.x, bbox.y);
+		auto p2 = Point(bbox.x + bbox.width, bbox.y + bbox.height);
+		auto mouse_center = Point((p1.x + p2.x) / 2, (p1.y + p2.y) / 2);
+		rectangle(image, p1, p2, Scalar(255, 25, 25), 2, 1);
+		circle(image, mouse_center, 3, Scalar(25, 25, 255), 1);
+	} else {
+		// Tracking failure
+		titleFont.draw(image, "Tracking failure detected", Point(100, 80), Scalar(0, 0, 255));
+	}
+	// Display tracker type on frame
+	titleFont.draw(image, trackerLabel, Point(100, 20), Scalar(50, 170, 50));
+
+	char text[64];
+	snprintf(text, sizeof(text), "Frame:%d, Arm:%s", frame, zoneName(zone));
+	titleFont.draw(image, text, Point(100, 50), Scalar(50, 170, 50));
+}
+
+void FrameOverlay::drawLine(Mat& image, const char* text, Point origin) const {
+	lineFont.draw(image, text, origin, Scalar(50, 170, 50));
+}
@@ -0,0 +1,43 @@
+// frameOverlay.h : the tracking annotations (box, centroid, tracker, frame and
+// arm) drawn in place from glyphs rendered once, so annotating a frame does
+// not allocate.
+//
+
+#pragma once
+
+#include "trackingEngine.h"
+
+#include <opencv2/core.hpp>
+
+#include <array>
+#include <string>
+
+// cv::putText builds its polylines in a fresh vector on every call, this
+// renders each printable ascii character once into a mask and stamps it
+class OverlayFont {
+public:
+	OverlayFont(int fontFace, double fontScale, int thickness);
+
+	// text with its baseline starting at origin, like cv::putText
+	void draw(cv::Mat& image, const char* text, cv::Point origin, const cv::Scalar& color) const;
+
+private:
+	static const int FIRST = ' ', LAST = '~';
+
+	std::array<cv::Mat, LAST - FIRST + 1> glyphs;
+	std::array<int, LAST - FIRST + 1> advance;
+	cv::Point offset;			// from the glyph mask's top left corner to its origin
+};
+
+class FrameOverlay {
+public:
+	explicit FrameOverlay(const std::string& trackerType);
+
+	void draw(cv::Mat& image, int frame, const cv::Rect& bbox, bool success, Zone zone) const;
+	// one line of small print, e.g. the stage timings
+	void drawLine(cv::Mat& image, const char* text, cv::Point origin) const;
+
+private:
+	OverlayFont titleFont, lineFont;
+	char trackerLabel[64];
+};
@@ -0,0 +1,237 @@
+// jobScheduler.cpp : Work-stealing pool for batch sessions.
+//
+
+#include "jobScheduler.h"
+
+#include <opencv2/core/utility.hpp>
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <thread>
+
+using namespace cv;
+using namespace std;
+
+int trackerCost(const string& type) {
+	// the DNN trackers run their network on OpenCV's own thread pool
+	if (type == "GOTURN" || type == "DaSiamRPN") {
+		return 4;
+	}
+	// tracker->update on one core, the decode thread mostly waits on the ring
+	return 1;
+}
+
+bool loadJobs(const string& path, vector<TrackingSession>& jobs, TrackerPresets presets, string* error) {
+	auto fail = [error](const string& message) {
+		if (error) {
+			*error = message;
+		}
+		return false;
+	};
+
+	FileStorage fs(path, FileStorage::READ);
+	if (!fs.isOpened()) {
+		return fail("Could not open the job list " + path);
+	}
+	auto list = fs["jobs"];
+	if (!list.isSeq()) {
+		return fail("Job list " + path + " has no jobs sequence");
+	}
+	if (fs["presets"].isMap()) {
+		presets.read(fs["presets"]);
+	}
+	jobs.clear();
+	for (auto node : list) {
+		TrackingSession session;
+		vector<int> triangle, bbox;
+		node["video"] >> session.videoPath;
+		node["triangle"] >> triangle;
+		node["bbox"] >> bbox;
+		if (!node["tracker"].empty()) {
+			node["tracker"] >> session.trackerType;
+		}
+		// through the presets even when not given, the list may override balanced
+		string preset = "balanced";
+		if (!node["preset"].empty()) {
+			node["preset"] >> preset;
+		}
+		if (!presets.find(preset, session.trackerParams)) {
+			return fail("Job " + to_string(jobs.size() + 1) + " in " + path + " has an unknown preset " + preset);
+		}
+		if (!node["backsub"].empty()) {
+			session.useBackSub = (int)node["backsub"] != 0;
+		}
+		if (!node["reacquire"].empty()) {
+			session.reacquire = (int)node["reacquire"] != 0;
+		}
+		if (!node["kalman"].empty()) {
+			session.predictWindow = (int)node["kalman"] != 0;
+		}
+		if (!node["bg_samples"].empty()) {
+			session.backgroundSamples = (int)node["bg_samples"];
+		}
+		if (!node["entry_debounce"].empty()) {
+			session.entryDebounce = (int)node["entry_debounce"];
+		}
+		if (!node["trajectory"].empty()) {
+			node["trajectory"] >> session.trajectoryPath;
+		}
+		if (!node["trajectory_bin"].empty()) {
+			node["trajectory_bin"] >> session.trajectoryBinPath;
+		}
+		if (!node["checkpoint"].empty()) {
+			node["checkpoint"] >> session.checkpointPath;
+		}
+		if (!node["checkpoint_interval"].empty()) {
+			session.checkpointInterval = (int)node["checkpoint_interval"];
+		}
+		if (!node["resume"].empty()) {
+			session.resume = (int)node["resume"] != 0;
+		}
+		if (!node["results"].empty()) {
+			node["results"] >> session.resultsPath;
+		}
+		if (!node["results_format"].empty()) {
+			node["results_format"] >> session.resultsFormat;
+		}
+		if (!node["truth"].empty()) {
+			node["truth"] >> session.truthPath;
+		}
+		if (!node["annotated"].empty()) {
+			node["annotated"] >> session.annotatedPath;
+		}
+		if (session.videoPath.empty() || triangle.size() != 6 || bbox.size() != 4) {
+			return fail("Job " + to_string(jobs.size() + 1) + " in " + path + " needs video, triangle and bbox");
+		}
+		for (int i = 0; i < 3; i++) {
+			session.triangle[i] = Point(triangle[i * 2], triangle[i * 2 + 1]);
+		}
+		session.bbox = Rect(bbox[0], bbox[1], bbox[2], bbox[3]);
+		jobs.push_back(session);
+	}
+	return true;
+}
+
+namespace {
+
+// counting semaphore over the cores the batch may use
+class CoreBudget {
+public:
+	explicit CoreBudget(int cores) : available(cores) {}
+	void acquire(int n) {
+		unique_lock<mutex> lock(budgetMutex);
+		freed.wait(lock, [&] { return available >= n; });
+		available -= n;
+	}
+	void release(int n) {
+		{
+			lock_guard<mutex> lock(budgetMutex);
+			available += n;
+		}
+		freed.notify_all();
+	}
+
+private:
+	int available;
+	mutex budgetMutex;
+	condition_variable freed;
+};
+
+struct WorkerQueue {
+	deque<size_t> jobs;
+	mutex queueMutex;
+};
+
+// own queue from the front, other queues from the back
+bool nextJob(vector<unique_ptr<WorkerQueue>>& queues, size_t self, size_t& job) {
+	for (size_t i = 0; i < queues.size(); i++) {
+		auto& queue = *queues[(self + i) % queues.size()];
+		lock_guard<mutex> lock(queue.queueMutex);
+		if (queue.jobs.empty()) {
+			continue;
+		}
+		if (i == 0) {
+			job = queue.jobs.front();
+			queue.jobs.pop_front();
+		} else {
+			job = queue.jobs.back();
+			queue.jobs.pop_back();
+		}
+		return true;
+	}
+	return false;
+}
+
+}
+
+BatchReport runBatch(const vector<TrackingSession>& jobs, int cores, const function<void(const JobReport&)>& onDone) {
+	BatchReport report;
+	report.jobs.resize(jobs.size());
+	if (jobs.empty()) {
+		return report;
+	}
+	if (cores <= 0) {
+		cores = max(1, getNumberOfCPUs());
+	}
+
+	// as many workers as the cheapest tracker allows, the budget keeps the
+	// expensive ones from oversubscribing the machine
+	auto minCost = cores;
+	for (auto& job : jobs) {
+		minCost = min(minCost, min(trackerCost(job.trackerType), cores));
+	}
+	auto workers = min<size_t>(jobs.size(), cores / max(minCost, 1));
+
+	// deal the most expensive jobs first so they do not end up last
+	vector<size_t> order(jobs.size());
+	iota(order.begin(), order.end(), 0);
+	stable_sort(order.begin(), order.end(), [&](size_t l, size_t r) {
+		return trackerCost(jobs[l].trackerType) > trackerCost(jobs[r].trackerType);
+	});
+	vector<unique_ptr<WorkerQueue>> queues;
+	for (size_t i = 0; i < workers; i++) {
+		queues.push_back(make_unique<WorkerQueue>());
+	}
+	for (size_t i = 0; i < order.size(); i++) {
+		queues[i % workers]->jobs.push_back(order[i]);
+	}
+
+	CoreBudget budget(cores);
+	auto start = getTickCount();
+	vector<thread> pool;
+	for (size_t w = 0; w < workers; w++) {
+		pool.emplace_back([&, w] {
+			size_t index;
+			while (nextJob(queues, w, index)) {
+				auto cost = min(trackerCost(jobs[index].trackerType), cores);
+				budget.acquire(cost);
+				auto& job = report.jobs[index];
+				job.index = index;
+				try {
+					job.ok = runTracking(jobs[index], job.result, nullptr, &job.error);
+				} catch (const exception& e) {
+					job.ok = false;
+					job.error = e.what();
+				}
+				budget.release(cost);
+				if (onDone) {
+					onDone(job);
+				}
+				// the trajectory is on disk by now, do not hold every session in memory
+				job.result.trajectory.clear();
+			}
+		});
+	}
+	for (auto& t : pool) {
+		t.join();
+	}
+	report.seconds = (getTickCount() - start) / getTickFrequency();
+	for (auto& job : report.jobs) {
+		report.frames += job.result.frames;
+	}
+	return report;
+}
@@ -0,0 +1,38 @@
+// jobScheduler.h : runs many tracking sessions concurrently on a
+// work-stealing pool that keeps the machine busy without oversubscribing it.
+//
+
+#pragma once
+
+#include "trackingEngine.h"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+struct JobReport {
+	size_t index = 0;						// position in the job list
+	TrackingResult result;
+	bool ok = false;
+	std::string error;
+};
+
+struct BatchReport {
+	std::vector<JobReport> jobs;			// in job list order
+	long long frames = 0;					// frames processed by all jobs
+	double seconds = 0;						// wall time of the whole batch
+	double fps() const { return seconds > 0 ? frames / seconds : 0; }
+};
+
+// cores one session of this tracker type keeps busy
+int trackerCost(const std::string& type);
+
+// reads a job list written with cv::FileStorage (yaml or json), see README,
+// a "presets" map in the list adds to the given presets
+bool loadJobs(const std::string& path, std::vector<TrackingSession>& jobs, TrackerPresets presets = TrackerPresets(),
+	std::string* error = nullptr);
+
+// cores 0 uses every hardware thread, onDone is called from the worker
+// threads as each job finishes and is the last chance to read its trajectory
+BatchReport runBatch(const std::vector<TrackingSession>& jobs, int cores = 0,
+	const std::function<void(const JobReport&)>& onDone = nullptr);
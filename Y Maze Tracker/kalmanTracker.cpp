@@ -0,0 +1,113 @@
+// kalmanTracker.cpp : Constant velocity prediction around tracker->update.
+//
+
+#include "kalmanTracker.h"
+
+using namespace cv;
+using namespace std;
+
+TrackerKalmanWindow::Params::Params() {
+	windowScale = 4;
+	maxCoast = 5;
+	processNoise = 1e-2f;
+	measurementNoise = 4;
+}
+
+Ptr<TrackerKalmanWindow> TrackerKalmanWindow::create(const function<Ptr<Tracker>()>& factory, const Params& parameters) {
+	return makePtr<TrackerKalmanWindow>(factory, parameters);
+}
+
+TrackerKalmanWindow::TrackerKalmanWindow(const function<Ptr<Tracker>()>& factory, const Params& parameters)
+	: params(parameters), factory(factory), kf(4, 2, 0, CV_32F), measurement(2, 1) {
+	// state is (cx, cy, vx, vy), one step per frame
+	kf.transitionMatrix = (Mat_<float>(4, 4) <<
+		1, 0, 1, 0,
+		0, 1, 0, 1,
+		0, 0, 1, 0,
+		0, 0, 0, 1);
+	kf.measurementMatrix = (Mat_<float>(2, 4) <<
+		1, 0, 0, 0,
+		0, 1, 0, 0);
+	setIdentity(kf.processNoiseCov, Scalar::all(params.processNoise));
+	setIdentity(kf.measurementNoiseCov, Scalar::all(params.measurementNoise));
+}
+
+void TrackerKalmanWindow::init(InputArray image, const Rect& boundingBox) {
+	Mat frame = image.getMat();
+	kf.statePost = (Mat_<float>(4, 1) <<
+		boundingBox.x + boundingBox.width / 2.f,
+		boundingBox.y + boundingBox.height / 2.f,
+		0, 0);
+	setIdentity(kf.errorCovPost, Scalar::all(1));
+	lastBox = boundingBox;
+	coast = 0;
+	placeWindow(frame, boundingBox);
+}
+
+// centers the window on box and starts the inner tracker inside it
+void TrackerKalmanWindow::placeWindow(const Mat& image, const Rect& box) {
+	window = Rect(0, 0, min((int)(box.width * params.windowScale), image.cols), min((int)(box.height * params.windowScale), image.rows));
+	window = windowAround(box, image.size());
+	auto local = (box & window) - window.tl();
+	if (local.empty()) {
+		// the box is outside the image
+		inner = nullptr;
+		return;
+	}
+	inner = factory();
+	inner->init(image(window), local);
+}
+
+// the current window size centered on box, shifted to stay inside the image
+Rect TrackerKalmanWindow::windowAround(const Rect& box, const Size& imageSize) const {
+	auto x = min(max(box.x + box.width / 2 - window.width / 2, 0), imageSize.width - window.width);
+	auto y = min(max(box.y + box.height / 2 - window.height / 2, 0), imageSize.height - window.height);
+	return Rect(x, y, window.width, window.height);
+}
+
+// box fits in the window with half a box to spare, except along image borders
+bool TrackerKalmanWindow::insideWindow(const Rect& box, const Size& imageSize) const {
+	auto left = window.x > 0 ? box.width / 2 : 0;
+	auto top = window.y > 0 ? box.height / 2 : 0;
+	auto right = window.x + window.width < imageSize.width ? box.width / 2 : 0;
+	auto bottom = window.y + window.height < imageSize.height ? box.height / 2 : 0;
+	return box.x >= window.x + left && box.y >= window.y + top
+		&& box.x + box.width <= window.x + window.width - right
+		&& box.y + box.height <= window.y + window.height - bottom;
+}
+
+bool TrackerKalmanWindow::update(InputArray image, Rect& boundingBox) {
+	Mat frame = image.getMat();
+	const Mat& prediction = kf.predict();
+	auto predicted = Rect((int)prediction.at<float>(0) - lastBox.width / 2, (int)prediction.at<float>(1) - lastBox.height / 2,
+		lastBox.width, lastBox.height);
+	if (inner && !insideWindow(predicted, frame.size())) {
+		// only the crop moves, the inner tracker keeps its model and finds the
+		// mouse shifted by at most a quarter box, well within its own search
+		// area. A restart would learn the unmeasured prediction instead.
+		auto target = windowAround(predicted, frame.size());
+		auto stepX = max(lastBox.width / 4, 1), stepY = max(lastBox.height / 4, 1);
+		window.x += min(max(target.x - window.x, -stepX), stepX);
+		window.y += min(max(target.y - window.y, -stepY), stepY);
+	}
+
+	Rect local;
+	if (inner && inner->update(frame(window), local)) {
+		lastBox = local + window.tl();
+		measurement(0) = lastBox.x + lastBox.width / 2.f;
+		measurement(1) = lastBox.y + lastBox.height / 2.f;
+		kf.correct(measurement);
+		coast = 0;
+		boundingBox = lastBox;
+		return true;
+	}
+
+	// predict() already advanced statePost, so coasting needs no correction
+	if (++coast > params.maxCoast) {
+		return false;
+	}
+	coasted += 1;
+	lastBox = predicted;
+	boundingBox = predicted;
+	return true;
+}
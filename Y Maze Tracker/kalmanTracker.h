@@ -0,0 +1,48 @@
+// kalmanTracker.h : wraps another tracker with a constant velocity Kalman
+// filter, the inner tracker only sees a window that follows the predicted
+// position and short dropouts are bridged by the prediction.
+//
+
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <opencv2/tracking.hpp>
+#include <opencv2/video/tracking.hpp>
+
+#include <functional>
+
+class TrackerKalmanWindow : public cv::Tracker {
+public:
+	struct Params {
+		Params();
+		float windowScale;			// search window size in multiples of the box size
+		int maxCoast;				// failed frames bridged by the prediction alone
+		float processNoise;			// Kalman process noise
+		float measurementNoise;		// Kalman measurement noise, in pixels^2
+	};
+
+	// factory creates the inner tracker on every init(), it may hand back the
+	// same tracker when that one can be initialized twice
+	static cv::Ptr<TrackerKalmanWindow> create(const std::function<cv::Ptr<cv::Tracker>()>& factory, const Params& parameters = Params());
+
+	void init(cv::InputArray image, const cv::Rect& boundingBox) override;
+	bool update(cv::InputArray image, cv::Rect& boundingBox) override;
+
+	// frames reported from the prediction while the inner tracker had failed
+	int coastedFrames() const { return coasted; }
+
+	TrackerKalmanWindow(const std::function<cv::Ptr<cv::Tracker>()>& factory, const Params& parameters);
+
+private:
+	void placeWindow(const cv::Mat& image, const cv::Rect& box);
+	cv::Rect windowAround(const cv::Rect& box, const cv::Size& imageSize) const;
+	bool insideWindow(const cv::Rect& box, const cv::Size& imageSize) const;
+
+	Params params;
+	std::function<cv::Ptr<cv::Tracker>()> factory;
+	cv::Ptr<cv::Tracker> inner;
+	cv::KalmanFilter kf;
+	cv::Mat_<float> measurement;
+	cv::Rect window, lastBox;
+	int coast = 0, coasted = 0;
+};
@@ -0,0 +1,88 @@
+// mazeSynth.cpp : Command line generator of synthetic Y maze videos and
+// their ground truth trajectories.
+//
+
+#include "syntheticMaze.h"
+#include "textFields.h"
+
+#include <opencv2/core/utility.hpp>
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace cv;
+using namespace std;
+
+const auto keys =
+	"{help h     |               | print this message }"
+	"{output o   | synthetic.avi | video to write, MJPG }"
+	"{truth      |               | ground truth trajectory csv }"
+	"{truth-bin  |               | ground truth in the binary trajectory format }"
+	"{width      | 640           | frame width }"
+	"{height     | 480           | frame height }"
+	"{fps        | 30            | frame rate }"
+	"{frames     | 900           | video length in frames }"
+	"{triangle t |               | maze center, x1,y1,x2,y2,x3,y3, centered by default }"
+	"{arm-length | 180           | from the center triangle to the end of an arm }"
+	"{mouse      | 36,16         | body length and width }"
+	"{speed      | 4             | px per frame }"
+	"{pause      | 30            | longest stay at the end of an arm, in frames }"
+	"{path       |               | arms to visit in order, e.g. ABCAB, random by default }"
+	"{noise      | 4             | sigma of the per-pixel noise }"
+	"{lighting   | 0.05          | amplitude of the slow brightness drift }"
+	"{seed       | 1             | random seed, the same seed gives the same video }";
+
+int main(int argc, char** argv) {
+	CommandLineParser parser(argc, argv, keys);
+	parser.about("Y Maze Tracker synthetic video generator");
+	if (parser.has("help")) {
+		parser.printMessage();
+		return 0;
+	}
+
+	SyntheticMaze::Params params;
+	params.size = Size(parser.get<int>("width"), parser.get<int>("height"));
+	params.fps = parser.get<double>("fps");
+	params.frames = parser.get<int>("frames");
+	params.armLength = parser.get<int>("arm-length");
+	params.speed = parser.get<double>("speed");
+	params.pauseFrames = parser.get<int>("pause");
+	params.path = parser.get<string>("path");
+	params.noise = parser.get<double>("noise");
+	params.lighting = parser.get<double>("lighting");
+	params.seed = (uint64_t)parser.get<int>("seed");
+	auto mouse = parseInts(parser.get<string>("mouse"));
+	auto triangle = parseInts(parser.get<string>("triangle"));
+	auto videoPath = parser.get<string>("output");
+	if (!parser.check() || mouse.size() != 2 || (parser.has("triangle") && triangle.size() != 6) ||
+		params.size.area() <= 0 || params.fps <= 0) {
+		parser.printErrors();
+		parser.printMessage();
+		return 1;
+	}
+	params.mouse = Size(mouse[0], mouse[1]);
+	if (triangle.size() == 6) {
+		for (int i = 0; i < 3; i++) {
+			params.triangle[i] = Point(triangle[i * 2], triangle[i * 2 + 1]);
+		}
+	} else {
+		// the default triangle, moved to the middle of the frame
+		auto shift = Point(params.size.width / 2 - 320, params.size.height / 2 - 240);
+		for (auto& vertex : params.triangle) {
+			vertex += shift;
+		}
+	}
+
+	string error;
+	if (!writeSyntheticVideo(params, videoPath, parser.get<string>("truth"), parser.get<string>("truth-bin"), &error)) {
+		fprintf(stderr, "%s\n", error.c_str());
+		return 1;
+	}
+	// ready to paste into ymaze_batch
+	auto& t = params.triangle;
+	auto box = SyntheticMaze(params).firstBox();
+	printf("--video=%s --triangle=%d,%d,%d,%d,%d,%d --bbox=%d,%d,%d,%d\n", videoPath.c_str(), t[0].x, t[0].y, t[1].x, t[1].y,
+		t[2].x, t[2].y, box.x, box.y, box.width, box.height);
+	return 0;
+}
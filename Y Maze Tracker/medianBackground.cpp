@@ -0,0 +1,194 @@
+// medianBackground.cpp : Median background model and the fused foreground
+// centroid kernel.
+//
+
+#include "medianBackground.h"
+
+#include <opencv2/imgproc.hpp>
+#include <opencv2/videoio.hpp>
+
+#include <algorithm>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#include <immintrin.h>
+#define HAVE_AVX2_KERNEL
+#endif
+
+using namespace cv;
+using namespace std;
+
+bool buildMedianBackground(const string& videoPath, int samples, Mat& background) {
+	// a capture of its own, so the tracking capture is never seeked
+	VideoCapture cap(videoPath);
+	if (!cap.isOpened() || samples <= 0) {
+		return false;
+	}
+	auto frameCount = (int)cap.get(CAP_PROP_FRAME_COUNT);
+	auto step = frameCount > samples ? frameCount / samples : 1;
+
+	vector<Mat> frames;
+	Mat frame;
+	for (auto i = 0; i < samples; i++) {
+		if (step > 1 && !cap.set(CAP_PROP_POS_FRAMES, (double)i * step)) {
+			step = 1;
+		}
+		if (!cap.read(frame) || frame.empty()) {
+			break;
+		}
+		Mat gray;
+		cvtColor(frame, gray, COLOR_BGR2GRAY);
+		frames.push_back(gray);
+	}
+	if (frames.empty()) {
+		return false;
+	}
+
+	background.create(frames[0].size(), CV_8UC1);
+	vector<uchar> values(frames.size());
+	auto middle = values.begin() + values.size() / 2;
+	for (auto y = 0; y < background.rows; y++) {
+		auto dst = background.ptr<uchar>(y);
+		for (auto x = 0; x < background.cols; x++) {
+			for (size_t i = 0; i < frames.size(); i++) {
+				values[i] = frames[i].ptr<uchar>(y)[x];
+			}
+			nth_element(values.begin(), middle, values.end());
+			dst[x] = *middle;
+		}
+	}
+	return true;
+}
+
+// scalar row kernel, also handles the tail of the AVX2 rows
+static inline void momentsRow(const uchar* a, const uchar* b, int from, int to, int thresh, int64_t& count, int64_t& sumX) {
+	for (auto x = from; x < to; x++) {
+		auto d = a[x] > b[x] ? a[x] - b[x] : b[x] - a[x];
+		if (d > thresh) {
+			count += 1;
+			sumX += x;
+		}
+	}
+}
+
+void foregroundMomentsScalar(const Mat& gray, const Mat& background, int thresh, ForegroundMoments& moments) {
+	CV_Assert(gray.type() == CV_8UC1 && background.type() == CV_8UC1 && gray.size() == background.size());
+	thresh = min(max(thresh, 0), 255);
+	moments = ForegroundMoments();
+	for (auto y = 0; y < gray.rows; y++) {
+		int64_t count = 0, sumX = 0;
+		momentsRow(gray.ptr<uchar>(y), background.ptr<uchar>(y), 0, gray.cols, thresh, count, sumX);
+		moments.count += count;
+		moments.sumX += sumX;
+		moments.sumY += count * y;
+	}
+}
+
+#ifdef HAVE_AVX2_KERNEL
+#if defined(__GNUC__)
+__attribute__((target("avx2")))
+#endif
+static void foregroundMomentsAVX2(const Mat& gray, const Mat& background, int thresh, ForegroundMoments& moments) {
+	moments = ForegroundMoments();
+	if (thresh >= 255) {
+		return;
+	}
+	const auto zero = _mm256_setzero_si256();
+	const auto ones8 = _mm256_set1_epi8(1);
+	const auto ones16 = _mm256_set1_epi16(1);
+	// d > thresh  <=>  max(d, thresh + 1) == d, thresh + 1 fits a byte
+	// because the caller clamped thresh
+	const auto limit = _mm256_set1_epi8((char)(thresh + 1));
+	const auto index = _mm256_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+		16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31);
+	const auto width = gray.cols;
+	const auto vectorWidth = width & ~31;
+
+	for (auto y = 0; y < gray.rows; y++) {
+		auto a = gray.ptr<uchar>(y);
+		auto b = background.ptr<uchar>(y);
+		auto count = zero;		// 4 x int64 pixel counts
+		auto base = zero;		// 4 x int64 sum of chunk offset * chunk count
+		auto local = zero;		// 8 x int32 sum of the index inside the chunk
+		for (auto x = 0; x < vectorWidth; x += 32) {
+			auto va = _mm256_loadu_si256((const __m256i*)(a + x));
+			auto vb = _mm256_loadu_si256((const __m256i*)(b + x));
+			auto d = _mm256_or_si256(_mm256_subs_epu8(va, vb), _mm256_subs_epu8(vb, va));
+			auto mask = _mm256_and_si256(_mm256_cmpeq_epi8(_mm256_max_epu8(d, limit), d), ones8);
+			auto chunkCount = _mm256_sad_epu8(mask, zero);
+			count = _mm256_add_epi64(count, chunkCount);
+			base = _mm256_add_epi64(base, _mm256_mul_epu32(chunkCount, _mm256_set1_epi64x(x)));
+			local = _mm256_add_epi32(local, _mm256_madd_epi16(_mm256_maddubs_epi16(mask, index), ones16));
+		}
+
+		alignas(32) int64_t counts[4], bases[4];
+		alignas(32) int32_t locals[8];
+		_mm256_store_si256((__m256i*)counts, count);
+		_mm256_store_si256((__m256i*)bases, base);
+		_mm256_store_si256((__m256i*)locals, local);
+		int64_t rowCount = counts[0] + counts[1] + counts[2] + counts[3];
+		int64_t rowSumX = bases[0] + bases[1] + bases[2] + bases[3];
+		for (auto v : locals) {
+			rowSumX += v;
+		}
+		momentsRow(a, b, vectorWidth, width, thresh, rowCount, rowSumX);
+
+		moments.count += rowCount;
+		moments.sumX += rowSumX;
+		moments.sumY += rowCount * y;
+	}
+}
+#endif
+
+bool foregroundMomentsAccelerated() {
+#ifdef HAVE_AVX2_KERNEL
+	static const bool haveAVX2 = checkHardwareSupport(CV_CPU_AVX2);
+	return haveAVX2;
+#else
+	return false;
+#endif
+}
+
+void foregroundMoments(const Mat& gray, const Mat& background, int thresh, ForegroundMoments& moments) {
+	CV_Assert(gray.type() == CV_8UC1 && background.type() == CV_8UC1 && gray.size() == background.size());
+	thresh = min(max(thresh, 0), 255);
+#ifdef HAVE_AVX2_KERNEL
+	if (foregroundMomentsAccelerated()) {
+		foregroundMomentsAVX2(gray, background, thresh, moments);
+		return;
+	}
+#endif
+	foregroundMomentsScalar(gray, background, thresh, moments);
+}
+
+TrackerMedianBackground::Params::Params() {
+	threshold = 40;
+	minArea = 30;
+}
+
+Ptr<TrackerMedianBackground> TrackerMedianBackground::create(const Mat& background, const Params& parameters) {
+	return makePtr<TrackerMedianBackground>(background, parameters);
+}
+
+TrackerMedianBackground::TrackerMedianBackground(const Mat& background, const Params& parameters)
+	: params(parameters), background(background) {
+}
+
+void TrackerMedianBackground::init(InputArray image, const Rect& boundingBox) {
+	boxSize = boundingBox.size();
+	gray.create(image.size(), CV_8UC1);
+}
+
+bool TrackerMedianBackground::update(InputArray image, Rect& boundingBox) {
+	// converts into the buffer allocated by init, no per-frame allocation
+	cvtColor(image, gray, COLOR_BGR2GRAY);
+	ForegroundMoments moments;
+	foregroundMoments(gray, background, params.threshold, moments);
+	if (moments.count < params.minArea) {
+		return false;
+	}
+	auto cx = (int)(moments.sumX / moments.count);
+	auto cy = (int)(moments.sumY / moments.count);
+	boundingBox = Rect(cx - boxSize.width / 2, cy - boxSize.height / 2, boxSize.width, boxSize.height);
+	return true;
+}
@@ -0,0 +1,50 @@
+// medianBackground.h : static median background of a fixed overhead camera
+// and a fused absdiff / threshold / moments kernel that locates the mouse
+// in a single pass without building a mask.
+//
+
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <opencv2/tracking.hpp>
+
+#include <cstdint>
+#include <string>
+
+// per-pixel median of samples gray frames spread evenly over the video
+bool buildMedianBackground(const std::string& videoPath, int samples, cv::Mat& background);
+
+struct ForegroundMoments {
+	int64_t count = 0;			// foreground pixels
+	int64_t sumX = 0, sumY = 0;	// first moments
+};
+
+// counts the pixels of gray differing from background by more than thresh
+// and their first moments, uses AVX2 when the cpu has it. thresh is clamped
+// to 0..255, the range of the difference
+void foregroundMoments(const cv::Mat& gray, const cv::Mat& background, int thresh, ForegroundMoments& moments);
+// false when foregroundMoments() runs the scalar kernel on this cpu
+bool foregroundMomentsAccelerated();
+// portable version of the same kernel
+void foregroundMomentsScalar(const cv::Mat& gray, const cv::Mat& background, int thresh, ForegroundMoments& moments);
+
+class TrackerMedianBackground : public cv::Tracker {
+public:
+	struct Params {
+		Params();
+		int threshold;				// gray level difference counted as foreground
+		int minArea;				// fewest foreground pixels accepted as the mouse
+	};
+
+	static cv::Ptr<TrackerMedianBackground> create(const cv::Mat& background, const Params& parameters = Params());
+
+	void init(cv::InputArray image, const cv::Rect& boundingBox) override;
+	bool update(cv::InputArray image, cv::Rect& boundingBox) override;
+
+	TrackerMedianBackground(const cv::Mat& background, const Params& parameters);
+
+private:
+	Params params;
+	cv::Mat background, gray;
+	cv::Size boxSize;
+};
@@ -0,0 +1,236 @@
+// metricsServer.cpp : Prometheus text exposition and a minimal HTTP/1.0
+// responder on the loopback interface.
+//
+
+#include "metricsServer.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+using namespace std;
+
+#ifdef _WIN32
+using socket_t = SOCKET;
+static void closeSocket(socket_t s) { closesocket(s); }
+#else
+using socket_t = int;
+static void closeSocket(socket_t s) { ::close(s); }
+#endif
+
+// a scraper that hangs up mid-response must not raise SIGPIPE and end the process
+#ifdef MSG_NOSIGNAL
+static const int sendFlags = MSG_NOSIGNAL;
+#else
+static const int sendFlags = 0;
+#endif
+
+// a client that connects and goes quiet must not hold up the loop or close()
+static void setTimeouts(socket_t s, int milliseconds) {
+#ifdef _WIN32
+	DWORD timeout = milliseconds;
+#else
+	timeval timeout = { milliseconds / 1000, (milliseconds % 1000) * 1000 };
+#endif
+	setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeout, sizeof(timeout));
+	setsockopt(s, SOL_SOCKET, SO_SNDTIMEO, (const char*)&timeout, sizeof(timeout));
+}
+
+MetricsServer::MetricsServer(int port) {
+#ifdef _WIN32
+	WSADATA wsa;
+	if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0) {
+		return;
+	}
+#endif
+	// the constructor's WSAStartup is undone here when it fails, by close() otherwise
+	auto giveUp = [] {
+#ifdef _WIN32
+		WSACleanup();
+#endif
+	};
+	auto s = socket(AF_INET, SOCK_STREAM, 0);
+	if ((intptr_t)s < 0) {
+		giveUp();
+		return;
+	}
+	// a second process must find the port taken, on Windows SO_REUSEADDR would
+	// let it bind the same port and steal half the scrapes
+	int option = 1;
+#ifdef _WIN32
+	setsockopt(s, SOL_SOCKET, SO_EXCLUSIVEADDRUSE, (const char*)&option, sizeof(option));
+#else
+	setsockopt(s, SOL_SOCKET, SO_REUSEADDR, (const char*)&option, sizeof(option));
+#endif
+	// loopback only, the counters hold file names
+	sockaddr_in address = {};
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	address.sin_port = htons((uint16_t)port);
+	socklen_t length = sizeof(address);
+	if (::bind(s, (sockaddr*)&address, sizeof(address)) != 0 || listen(s, 8) != 0 ||
+		getsockname(s, (sockaddr*)&address, &length) != 0) {
+		closeSocket(s);
+		giveUp();
+		return;
+	}
+	boundPort = ntohs(address.sin_port);
+	listener = (intptr_t)s;
+	worker = thread(&MetricsServer::serveLoop, this);
+}
+
+MetricsServer::~MetricsServer() {
+	close();
+}
+
+void MetricsServer::add(shared_ptr<LiveMetrics> metrics) {
+	lock_guard<mutex> lock(sessionsMutex);
+	sessions.emplace_back(++runs, move(metrics));
+}
+
+void MetricsServer::removeFinished() {
+	lock_guard<mutex> lock(sessionsMutex);
+	sessions.erase(remove_if(sessions.begin(), sessions.end(), [](auto& session) { return !session.second->running; }),
+		sessions.end());
+}
+
+// label values escape backslashes, quotes and newlines
+static string labelValue(const string& text) {
+	string escaped;
+	for (auto c : text) {
+		if (c == '\n') {
+			escaped += "\\n";
+			continue;
+		}
+		if (c == '\\' || c == '"') {
+			escaped += '\\';
+		}
+		escaped += c;
+	}
+	return escaped;
+}
+
+string MetricsServer::render() {
+	vector<shared_ptr<LiveMetrics>> snapshot;
+	vector<string> labels;
+	{
+		lock_guard<mutex> lock(sessionsMutex);
+		for (auto& [run, metrics] : sessions) {
+			snapshot.push_back(metrics);
+			labels.push_back("video=\"" + labelValue(metrics->video) + "\",tracker=\"" + labelValue(metrics->tracker) +
+				"\",run=\"" + to_string(run) + "\"");
+		}
+	}
+
+	string text;
+	char line[128];
+	// one family at a time, the format wants every sample of a family together
+	auto family = [&](const char* name, const char* type, const char* help, auto value) {
+		text += string("# HELP ") + name + " " + help + "\n# TYPE " + name + " " + type + "\n";
+		for (size_t i = 0; i < snapshot.size(); i++) {
+			snprintf(line, sizeof(line), "} %.17g\n", (double)value(*snapshot[i]));
+			text += name + string("{") + labels[i] + line;
+		}
+	};
+	family("ymaze_running", "gauge", "1 while the session is tracking.", [](LiveMetrics& m) { return m.running.load() ? 1 : 0; });
+	family("ymaze_frames_total", "counter", "Frames processed.", [](LiveMetrics& m) { return m.frames.load(); });
+	family("ymaze_failures_total", "counter", "Frames where the tracker update failed.", [](LiveMetrics& m) { return m.failures.load(); });
+	family("ymaze_reacquisitions_total", "counter", "Tracker re-inits on a foreground blob.", [](LiveMetrics& m) { return m.reacquisitions.load(); });
+	family("ymaze_fps", "gauge", "Frames per second over the last few frames.", [](LiveMetrics& m) { return m.fps.load(); });
+	family("ymaze_decode_queue_depth", "gauge", "Frames decoded ahead of the tracker.", [](LiveMetrics& m) { return m.decodeQueue.load(); });
+
+	// per stage, the mean latency is seconds / calls
+	const char* stageFamilies[][3] = {
+		{ "ymaze_stage_calls_total", "counter", "Times each stage of the loop ran." },
+		{ "ymaze_stage_seconds_total", "counter", "Time spent in each stage of the loop." },
+	};
+	for (auto f = 0; f < 2; f++) {
+		text += string("# HELP ") + stageFamilies[f][0] + " " + stageFamilies[f][2] + "\n# TYPE " + stageFamilies[f][0] + " " +
+			stageFamilies[f][1] + "\n";
+		for (size_t i = 0; i < snapshot.size(); i++) {
+			for (auto stage = 0; stage < STAGE_COUNT; stage++) {
+				auto calls = snapshot[i]->stageCalls[stage].load();
+				if (!calls) {
+					continue;
+				}
+				auto value = f == 0 ? (double)calls : snapshot[i]->stageSeconds[stage].load();
+				snprintf(line, sizeof(line), ",stage=\"%s\"} %.17g\n", stageNames[stage], value);
+				text += stageFamilies[f][0] + string("{") + labels[i] + line;
+			}
+		}
+	}
+	return text;
+}
+
+void MetricsServer::serveLoop() {
+	auto s = (socket_t)listener;
+	while (!stopping) {
+		// wakes up now and then to notice close()
+		fd_set ready;
+		FD_ZERO(&ready);
+		FD_SET(s, &ready);
+		timeval timeout = { 0, 200000 };
+		if (select((int)s + 1, &ready, nullptr, nullptr, &timeout) <= 0) {
+			continue;
+		}
+		auto client = accept(s, nullptr, nullptr);
+		if ((intptr_t)client < 0) {
+			continue;
+		}
+		setTimeouts(client, 500);
+#ifdef SO_NOSIGPIPE
+		// macOS has no MSG_NOSIGNAL, the socket itself is told instead
+		int noSigPipe = 1;
+		setsockopt(client, SOL_SOCKET, SO_NOSIGPIPE, &noSigPipe, sizeof(noSigPipe));
+#endif
+		// the request line is enough, a scraper sends it in the first packet
+		char request[1024];
+		auto received = recv(client, request, sizeof(request) - 1, 0);
+		if (received <= 0) {
+			closeSocket(client);
+			continue;
+		}
+		request[received] = 0;
+		string body, status = "200 OK";
+		if (strncmp(request, "GET /metrics ", 13) == 0 || strncmp(request, "GET / ", 6) == 0) {
+			body = render();
+		} else {
+			status = "404 Not Found";
+		}
+		auto response = "HTTP/1.0 " + status + "\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: " +
+			to_string(body.size()) + "\r\nConnection: close\r\n\r\n" + body;
+		for (size_t sent = 0; sent < response.size();) {
+			auto n = send(client, response.data() + sent, (int)(response.size() - sent), sendFlags);
+			if (n <= 0) {
+				break;
+			}
+			sent += n;
+		}
+		closeSocket(client);
+	}
+}
+
+void MetricsServer::close() {
+	if (listener < 0) {
+		return;
+	}
+	stopping = true;
+	worker.join();
+	closeSocket((socket_t)listener);
+	listener = -1;
+#ifdef _WIN32
+	WSACleanup();
+#endif
+}
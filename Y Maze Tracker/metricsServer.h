@@ -0,0 +1,68 @@
+// metricsServer.h : live counters of running sessions served in the Prometheus
+// text format over loopback HTTP, so a run can be watched while it goes.
+//
+
+#pragma once
+
+#include "stageTimers.h"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// published by the tracking thread every few frames and only read by the
+// server, the counters start on their own cache line so the scrapes never
+// share one with the labels or with anything else the loop writes
+struct LiveMetrics {
+	LiveMetrics(const std::string& video, const std::string& tracker) : video(video), tracker(tracker) {}
+
+	const std::string video, tracker;		// labels, fixed for the life of the session
+
+	alignas(64) std::atomic<bool> running = false;
+	std::atomic<int64_t> frames = 0;
+	std::atomic<int64_t> failures = 0;
+	std::atomic<int64_t> reacquisitions = 0;
+	std::atomic<int64_t> decodeQueue = 0;	// frames decoded ahead and waiting
+	std::atomic<double> fps = 0;			// over the last publish interval
+	std::array<std::atomic<int64_t>, STAGE_COUNT> stageCalls = {};
+	std::array<std::atomic<double>, STAGE_COUNT> stageSeconds = {};
+};
+
+class MetricsServer {
+public:
+	// listens on 127.0.0.1:port, port 0 picks a free one
+	explicit MetricsServer(int port);
+	~MetricsServer();
+	MetricsServer(const MetricsServer&) = delete;
+	MetricsServer& operator=(const MetricsServer&) = delete;
+
+	bool isOpen() const { return listener >= 0; }
+	int port() const { return boundPort; }
+
+	// sessions stay listed after they finish, with ymaze_running 0, each one
+	// under its own run label so running the same video again starts new series
+	void add(std::shared_ptr<LiveMetrics> metrics);
+	// drops the finished sessions, a server that outlives many runs calls it
+	// before adding the next one
+	void removeFinished();
+	// the whole exposition, what a GET returns
+	std::string render();
+	void close();
+
+private:
+	void serveLoop();
+
+	intptr_t listener = -1;
+	int boundPort = 0;
+	std::atomic<bool> stopping = false;
+	std::mutex sessionsMutex;
+	std::vector<std::pair<int, std::shared_ptr<LiveMetrics>>> sessions;	// run label and counters
+	int runs = 0;											// sessions ever added
+	std::thread worker;
+};
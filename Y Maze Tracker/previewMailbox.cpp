@@ -0,0 +1,69 @@
+// previewMailbox.cpp : Latest-frame slot between the tracking and render
+// stages.
+//
+
+#include "previewMailbox.h"
+
+using namespace cv;
+using namespace std;
+
+int PreviewRate::waitMs() const {
+	switch (mode) {
+	case CAPPED:
+		return max(1, (int)(1000 / max(maxFps, 1.0)) / 4);
+	case OFF:
+		// only ESC is polled
+		return 100;
+	default:
+		return 1;
+	}
+}
+
+void PreviewMailbox::reserve(const Size& size, int type) {
+	lock_guard<mutex> lock(mailboxMutex);
+	pending.image.create(size, type);
+}
+
+void PreviewMailbox::offer(const FrameInfo& info) {
+	if (rate.mode == PreviewRate::OFF || (rate.mode == PreviewRate::EVERY_NTH && info.frame % max(rate.everyNth, 1) != 0)) {
+		return;
+	}
+	if (!wanted.load(memory_order_relaxed)) {
+		return;
+	}
+	lock_guard<mutex> lock(mailboxMutex);
+	info.image.copyTo(pending.image);
+	pending.frame = info.frame;
+	pending.bbox = info.bbox;
+	pending.success = info.success;
+	pending.zone = info.zone;
+	for (auto i = 0; i < STAGE_COUNT; i++) {
+		pending.stageMeanMs[i] = (float)info.result.timings[(Stage)i].meanMs();
+	}
+	ready = true;
+}
+
+bool PreviewMailbox::take(PreviewFrame& frame) {
+	if (rate.mode == PreviewRate::OFF) {
+		return false;
+	}
+	// not asking for a frame also keeps the tracking thread from copying one
+	auto now = rate.mode == PreviewRate::CAPPED ? getTickCount() : 0;
+	if (now < nextRefresh) {
+		return false;
+	}
+	lock_guard<mutex> lock(mailboxMutex);
+	if (!ready) {
+		wanted.store(true, memory_order_relaxed);
+		return false;
+	}
+	// swap so both image buffers are reused instead of reallocated, no frame
+	// is copied while the renderer draws this one
+	swap(pending, frame);
+	ready = false;
+	wanted.store(false, memory_order_relaxed);
+	if (rate.mode == PreviewRate::CAPPED) {
+		nextRefresh = now + (int64_t)(getTickFrequency() / max(rate.maxFps, 1.0));
+	}
+	return true;
+}
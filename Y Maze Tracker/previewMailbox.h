@@ -0,0 +1,60 @@
+// previewMailbox.h : hands the newest tracked frame from the tracking thread
+// to the render stage, frames the renderer is too slow for are dropped.
+//
+
+#pragma once
+
+#include "trackingEngine.h"
+
+#include <array>
+#include <atomic>
+#include <mutex>
+
+struct PreviewFrame {
+	cv::Mat image;
+	int frame = 0;
+	cv::Rect bbox;
+	bool success = false;
+	Zone zone = ZONE_NONE;
+	std::array<float, STAGE_COUNT> stageMeanMs = {};	// engine stages so far, for the timing overlay
+};
+
+// how often the preview is refreshed, tracking still processes every frame
+struct PreviewRate {
+	enum Mode {
+		LIVE = 0,			// the newest frame whenever the renderer is free
+		EVERY_NTH,			// only every everyNth frame is offered
+		CAPPED,				// at most maxFps refreshes per second of wall time
+		OFF,				// nothing is copied or drawn
+	};
+	Mode mode = LIVE;
+	int everyNth = 10;
+	double maxFps = 10;
+
+	// ms the render loop may wait for a key before looking for a frame again
+	int waitMs() const;
+};
+
+class PreviewMailbox {
+public:
+	explicit PreviewMailbox(const PreviewRate& rate = PreviewRate()) : rate(rate) {}
+
+	// sizes the frame buffer at open time, so the first offer does not allocate
+	void reserve(const cv::Size& size, int type);
+	// tracking thread: copies the frame only when the renderer is waiting for
+	// one and the rate lets the frame through, a frame not taken yet is
+	// replaced by the newer one. Otherwise returns without touching the image
+	void offer(const FrameInfo& info);
+	// render thread: swaps the newest frame into frame, returns false and
+	// waits for one if nothing arrived since the last call or a capped rate
+	// makes it too early for the next refresh
+	bool take(PreviewFrame& frame);
+
+private:
+	const PreviewRate rate;
+	int64_t nextRefresh = 0;	// tick count of the next capped refresh, render thread only
+	std::atomic<bool> wanted = true;	// the renderer is waiting, set by take() until it gets a frame
+	bool ready = false;
+	PreviewFrame pending;
+	std::mutex mailboxMutex;
+};
@@ -38,7 +38,15 @@
 #define IDC_BOOSTING					707
 #define IDC_TLD							708
 #define IDC_MEDIANFLOW					709
+#define IDC_BACKSUBTRACKER				710
+#define IDC_MEDIANBG					711
 
 
 // checkbox
 #define IDC_BACKSUB						751
+#define IDC_KALMAN						752
+#define IDC_TRACE						753
+#define IDC_PREVIEW						754
+#define IDC_EXPORT						755
+#define IDC_METRICS						756
+#define IDC_REACQUIRE					757
@@ -0,0 +1,222 @@
+// resultWriter.cpp : Double-buffered background writer and its csv / ndjson
+// sinks.
+//
+
+#include "resultWriter.h"
+
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <exception>
+#include <vector>
+
+using namespace cv;
+using namespace std;
+
+void CsvSink::header(string& out) {
+	out += "frame,timestamp_ms,x,y,width,height,success,zone\n";
+}
+
+void CsvSink::format(const FrameInfo& info, string& out) {
+	char line[160];
+	auto n = snprintf(line, sizeof(line), "%d,%.3f,%d,%d,%d,%d,%d,%s\n", info.frame, info.timestamp,
+		info.bbox.x, info.bbox.y, info.bbox.width, info.bbox.height, info.success ? 1 : 0, zoneName(info.zone));
+	out.append(line, min<size_t>(n, sizeof(line) - 1));
+}
+
+void NdjsonSink::format(const FrameInfo& info, string& out) {
+	char line[200];
+	auto n = snprintf(line, sizeof(line),
+		"{\"frame\":%d,\"timestamp_ms\":%.3f,\"x\":%d,\"y\":%d,\"width\":%d,\"height\":%d,\"success\":%s,\"zone\":\"%s\"}\n",
+		info.frame, info.timestamp, info.bbox.x, info.bbox.y, info.bbox.width, info.bbox.height,
+		info.success ? "true" : "false", zoneName(info.zone));
+	out.append(line, min<size_t>(n, sizeof(line) - 1));
+}
+
+unique_ptr<ResultSink> createSink(const string& format) {
+	if (format == "csv") {
+		return make_unique<CsvSink>();
+	} else if (format == "ndjson") {
+		return make_unique<NdjsonSink>();
+	}
+	return nullptr;
+}
+
+// open writers, for the crash path
+static mutex registryMutex;
+static vector<ResultWriter*> writers;
+
+ResultWriter::ResultWriter(const string& path, unique_ptr<ResultSink> sink, size_t blockSize)
+	: sink(move(sink)), blockSize(max<size_t>(blockSize, 4096)) {
+	if (path == "-") {
+		file = stdout;
+	} else {
+		file = fopen(path.c_str(), "wb");
+		ownsFile = true;
+	}
+	if (!file || !this->sink) {
+		file = nullptr;
+		return;
+	}
+	front.reserve(this->blockSize + 256);
+	back.reserve(this->blockSize + 256);
+	this->sink->header(front);
+	worker = thread(&ResultWriter::ioLoop, this);
+	lock_guard<mutex> lock(registryMutex);
+	writers.push_back(this);
+}
+
+ResultWriter::~ResultWriter() {
+	close();
+}
+
+void ResultWriter::write(const FrameInfo& info) {
+	if (!file) {
+		return;
+	}
+	// formatted under the lock so the crash path never sees a half appended row
+	bool full;
+	{
+		lock_guard<mutex> lock(writerMutex);
+		sink->format(info, front);
+		full = front.size() >= blockSize;
+	}
+	if (full) {
+		submit(false);
+	}
+}
+
+// hands front to the I/O thread, waiting only if the previous block is still
+// being written
+void ResultWriter::submit(bool wait) {
+	unique_lock<mutex> lock(writerMutex);
+	changed.wait(lock, [this] { return !backPending; });
+	swap(front, back);
+	backPending = true;
+	changed.notify_all();
+	if (wait) {
+		changed.wait(lock, [this] { return !backPending; });
+	}
+}
+
+void ResultWriter::flush() {
+	if (!file) {
+		return;
+	}
+	submit(true);
+	fflush(file);
+}
+
+void ResultWriter::close() {
+	if (!file) {
+		return;
+	}
+	flush();
+	{
+		lock_guard<mutex> lock(registryMutex);
+		writers.erase(remove(writers.begin(), writers.end(), this), writers.end());
+	}
+	{
+		lock_guard<mutex> lock(writerMutex);
+		stopping = true;
+	}
+	changed.notify_all();
+	worker.join();
+	if (ownsFile) {
+		failed |= fclose(file) != 0;
+	}
+	file = nullptr;
+}
+
+void ResultWriter::ioLoop() {
+	unique_lock<mutex> lock(writerMutex);
+	for (;;) {
+		changed.wait(lock, [this] { return backPending || stopping; });
+		if (!backPending) {
+			break;
+		}
+		// back belongs to this thread until backPending is cleared
+		backWriting = true;
+		lock.unlock();
+		auto ok = fwrite(back.data(), 1, back.size(), file) == back.size();
+		lock.lock();
+		failed |= !ok;
+		back.clear();
+		backPending = false;
+		backWriting = false;
+		changed.notify_all();
+	}
+}
+
+void ResultWriter::emergencyFlush() {
+	// never block on a thread that may be the one that crashed
+	unique_lock<mutex> lock(writerMutex, try_to_lock);
+	if (!lock.owns_lock() || !file) {
+		return;
+	}
+	// a block the I/O thread is in the middle of writing stays its own, wait
+	// a little for it so the rows stay in order, and never write it twice
+	changed.wait_for(lock, chrono::seconds(1), [this] { return !backWriting; });
+	if (backPending && !backWriting) {
+		fwrite(back.data(), 1, back.size(), file);
+		back.clear();
+		backPending = false;
+	}
+	fwrite(front.data(), 1, front.size(), file);
+	front.clear();
+	fflush(file);
+}
+
+void flushAllWriters() {
+	unique_lock<mutex> lock(registryMutex, try_to_lock);
+	if (!lock.owns_lock()) {
+		return;
+	}
+	for (auto writer : writers) {
+		writer->emergencyFlush();
+	}
+}
+
+static terminate_handler previousTerminate;
+
+// the handler only records the signal, locks and stdio are not safe in it.
+// A second one gets the default action and ends the process right away
+static volatile sig_atomic_t pendingSignal = 0;
+
+static void flushOnSignal(int sig) {
+	pendingSignal = sig;
+	signal(sig, SIG_DFL);
+}
+
+// the flush runs here, on an ordinary thread that may wait for the writers
+static void watchSignals() {
+	while (!pendingSignal) {
+		this_thread::sleep_for(chrono::milliseconds(50));
+	}
+	int sig = pendingSignal;
+	{
+		lock_guard<mutex> lock(registryMutex);
+		for (auto writer : writers) {
+			writer->flush();
+		}
+	}
+	raise(sig);
+}
+
+void installCrashFlush() {
+	static once_flag installed;
+	call_once(installed, [] {
+		atexit(flushAllWriters);
+		previousTerminate = set_terminate([] {
+			flushAllWriters();
+			if (previousTerminate) {
+				previousTerminate();
+			}
+			abort();
+		});
+		thread(watchSignals).detach();
+		signal(SIGINT, flushOnSignal);
+		signal(SIGTERM, flushOnSignal);
+	});
+}
@@ -0,0 +1,82 @@
+// resultWriter.h : per-frame result output formatted on the tracking thread
+// into large blocks that a background thread writes, so the hot loop never
+// does a small synchronous write.
+//
+
+#pragma once
+
+#include "trackingEngine.h"
+
+#include <condition_variable>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// formats one frame at a time into text
+class ResultSink {
+public:
+	virtual ~ResultSink() {}
+	virtual void header(std::string& out) {}
+	virtual void format(const FrameInfo& info, std::string& out) = 0;
+};
+
+class CsvSink : public ResultSink {
+public:
+	void header(std::string& out) override;
+	void format(const FrameInfo& info, std::string& out) override;
+};
+
+// one json object per line
+class NdjsonSink : public ResultSink {
+public:
+	void format(const FrameInfo& info, std::string& out) override;
+};
+
+// "csv" or "ndjson", nullptr for anything else
+std::unique_ptr<ResultSink> createSink(const std::string& format);
+
+class ResultWriter {
+public:
+	// path "-" writes to stdout
+	ResultWriter(const std::string& path, std::unique_ptr<ResultSink> sink, size_t blockSize = 1 << 20);
+	~ResultWriter();
+	ResultWriter(const ResultWriter&) = delete;
+	ResultWriter& operator=(const ResultWriter&) = delete;
+
+	bool isOpen() const { return file != nullptr; }
+	// false once a write to the file failed
+	bool good() const { return !failed; }
+
+	void write(const FrameInfo& info);
+	// writes everything formatted so far and waits for it
+	void flush();
+	void close();
+
+private:
+	void submit(bool wait);
+	void ioLoop();
+	// crash path: writes both blocks from the calling thread, see installCrashFlush()
+	void emergencyFlush();
+	friend void flushAllWriters();
+
+	std::unique_ptr<ResultSink> sink;
+	FILE* file = nullptr;
+	bool ownsFile = false;
+	size_t blockSize;
+	std::string front;				// filled by write(), under writerMutex
+	std::string back;				// being written by the I/O thread
+	bool backPending = false;
+	bool backWriting = false;		// the I/O thread is in fwrite(back) without the lock
+	bool stopping = false;
+	bool failed = false;
+	std::mutex writerMutex;
+	std::condition_variable changed;
+	std::thread worker;
+};
+
+// flushes every open writer at exit and on std::terminate, and from a
+// watcher thread on SIGINT / SIGTERM before the signal ends the process
+void installCrashFlush();
+void flushAllWriters();
@@ -0,0 +1,73 @@
+// showConvert.h : conversion of any displayable image into the bottom-up
+// 8-bit BGR layout of a Windows DIB section, a single pass for 8-bit images,
+// replacing the convertToShow + cv::flip pair of the Win32 window.
+//
+
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <opencv2/core/hal/intrin.hpp>
+
+#include <cstring>
+
+// one row of cn channel values already in 0..255, alpha dropped, gray expanded
+inline void showPackRow(const uchar* s, uchar* d, int cols, int cn) {
+	int x = 0;
+	if (cn == 3) {
+		memcpy(d, s, (size_t)cols * 3);
+		return;
+	}
+#if CV_SIMD128
+	if (cn == 4) {
+		for (; x <= cols - 16; x += 16) {
+			cv::v_uint8x16 b, g, r, a;
+			cv::v_load_deinterleave(s + x * 4, b, g, r, a);
+			cv::v_store_interleave(d + x * 3, b, g, r);
+		}
+	} else if (cn == 1) {
+		for (; x <= cols - 16; x += 16) {
+			auto v = cv::v_load(s + x);
+			cv::v_store_interleave(d + x * 3, v, v, v);
+		}
+	}
+#endif
+	for (; x < cols; x++) {
+		auto p = s + x * cn;
+		d[x * 3] = p[0];
+		d[x * 3 + 1] = cn == 1 ? p[0] : p[1];
+		d[x * 3 + 2] = cn == 1 ? p[0] : p[2];
+	}
+}
+
+// writes src into dst, rows * dstStep bytes, as 8-bit BGR rows from the
+// bottom row up. 8-bit images are read once and every destination byte is
+// written once, the other depths convertToShow takes are first brought to
+// 8 bits by OpenCV's own conversions. src has 1, 3 or 4 channels.
+inline void convertToShowFlipped(const cv::Mat& src, uchar* dst, size_t dstStep) {
+	const int depth = src.depth(), cn = src.channels();
+	CV_Assert(depth != CV_16F && depth != CV_32S && (cn == 1 || cn == 3 || cn == 4));
+	if (depth != CV_8U) {
+		// kept per thread, the preview converts the same size every frame
+		static thread_local cv::Mat converted;
+		switch (depth) {
+		case CV_8S:
+			cv::convertScaleAbs(src, converted, 1, 127);
+			break;
+		case CV_16S:
+			cv::convertScaleAbs(src, converted, 1 / 255., 127);
+			break;
+		case CV_16U:
+			cv::convertScaleAbs(src, converted, 1 / 255.);
+			break;
+		default:
+			// assuming image has values in range [0, 1)
+			src.convertTo(converted, CV_8U, 255., 0.);
+			break;
+		}
+		convertToShowFlipped(converted, dst, dstStep);
+		return;
+	}
+	for (int y = 0; y < src.rows; y++) {
+		showPackRow(src.ptr<uchar>(y), dst + (size_t)(src.rows - 1 - y) * dstStep, src.cols, cn);
+	}
+}
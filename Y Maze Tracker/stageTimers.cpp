@@ -0,0 +1,126 @@
+// stageTimers.cpp : Histogram bucketing and the text / json summaries.
+//
+
+#include "stageTimers.h"
+#include "traceRecorder.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdio>
+
+using namespace cv;
+using namespace std;
+
+const array<const char*, STAGE_COUNT> stageNames = {
+	"decode", "backsub", "update", "reacquire", "classify", "output", "overlay", "show", "waitkey",
+};
+
+// 0-3 ns get a bucket each, above that the leading bit picks the octave and
+// the next two bits the quarter of it
+static int bucketOf(int64_t ns) {
+	auto value = (uint64_t)max<int64_t>(ns, 0);
+	if (value < 4) {
+		return (int)value;
+	}
+	auto msb = (int)bit_width(value) - 1;
+	auto quarter = (int)((value >> (msb - 2)) & 3);
+	return min(4 * (msb - 1) + quarter, StageHistogram::BUCKETS - 1);
+}
+
+static double bucketMidNs(int bucket) {
+	if (bucket < 4) {
+		return bucket;
+	}
+	auto msb = bucket / 4 + 1;
+	auto quarter = bucket % 4;
+	return ldexp(4.5 + quarter, msb - 2);
+}
+
+void StageHistogram::record(int64_t ns) {
+	samples += 1;
+	totalNs += ns;
+	maxNs = max(maxNs, ns);
+	buckets[bucketOf(ns)] += 1;
+}
+
+void StageHistogram::merge(const StageHistogram& other) {
+	samples += other.samples;
+	totalNs += other.totalNs;
+	maxNs = max(maxNs, other.maxNs);
+	for (auto i = 0; i < BUCKETS; i++) {
+		buckets[i] += other.buckets[i];
+	}
+}
+
+double StageHistogram::percentileMs(double p) const {
+	if (!samples) {
+		return 0;
+	}
+	auto rank = (int64_t)(p * (samples - 1)) + 1;
+	int64_t seen = 0;
+	for (auto i = 0; i < BUCKETS; i++) {
+		seen += buckets[i];
+		if (seen >= rank) {
+			// the bucket middle can overshoot the largest sample
+			return min(bucketMidNs(i), (double)maxNs) / 1e6;
+		}
+	}
+	return maxMs();
+}
+
+void StageTimers::record(Stage stage, int64_t beginTicks, int64_t endTicks) {
+	static const double nsPerTick = 1e9 / getTickFrequency();
+	stages[stage].record((int64_t)((endTicks - beginTicks) * nsPerTick));
+	if (trace) {
+		trace->span(stageNames[stage], beginTicks, endTicks, currentFrame);
+	}
+}
+
+void StageTimers::merge(const StageTimers& other) {
+	for (auto i = 0; i < STAGE_COUNT; i++) {
+		stages[i].merge(other.stages[i]);
+	}
+}
+
+string StageTimers::summary() const {
+	string text = "stage          count    mean ms     p50 ms     p90 ms     p99 ms     max ms\n";
+	char line[160];
+	for (auto i = 0; i < STAGE_COUNT; i++) {
+		auto& h = stages[i];
+		if (!h.count()) {
+			continue;
+		}
+		snprintf(line, sizeof(line), "%-10s %9lld %10.3f %10.3f %10.3f %10.3f %10.3f\n", stageNames[i], (long long)h.count(),
+			h.meanMs(), h.percentileMs(0.5), h.percentileMs(0.9), h.percentileMs(0.99), h.maxMs());
+		text += line;
+	}
+	return text;
+}
+
+string StageTimers::json() const {
+	string text = "{";
+	char entry[256];
+	for (auto i = 0; i < STAGE_COUNT; i++) {
+		auto& h = stages[i];
+		if (!h.count()) {
+			continue;
+		}
+		snprintf(entry, sizeof(entry), "%s\"%s\":{\"count\":%lld,\"total_ms\":%.3f,\"mean_ms\":%.4f,\"p50_ms\":%.4f,\"p90_ms\":%.4f,"
+			"\"p99_ms\":%.4f,\"max_ms\":%.4f}", text.size() > 1 ? "," : "", stageNames[i], (long long)h.count(), h.totalMs(),
+			h.meanMs(), h.percentileMs(0.5), h.percentileMs(0.9), h.percentileMs(0.99), h.maxMs());
+		text += entry;
+	}
+	return text + "}";
+}
+
+bool StageTimers::writeJson(const string& path) const {
+	auto file = fopen(path.c_str(), "w");
+	if (!file) {
+		return false;
+	}
+	auto text = json();
+	fputs(text.c_str(), file);
+	fputc('\n', file);
+	return fclose(file) == 0;
+}
@@ -0,0 +1,93 @@
+// stageTimers.h : per-stage latency histograms of the tracking loop, fed by
+// scoped getTickCount timers cheap enough to stay on in every run.
+//
+
+#pragma once
+
+#include <opencv2/core.hpp>
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+class TraceRecorder;
+
+enum Stage {
+	STAGE_DECODE = 0,		// waiting for the decoder to hand out the next frame
+	STAGE_BACKSUB,			// pBackSub->apply
+	STAGE_UPDATE,			// tracker->update
+	STAGE_REACQUIRE,		// blob search and re-init after a failure
+	STAGE_CLASSIFY,			// zone lookup, counters and behavior metrics
+	STAGE_OUTPUT,			// trajectory, streamed results, checkpoints and the frame callback
+	STAGE_OVERLAY,			// preview drawing, Windows only
+	STAGE_SHOW,				// cvShowImage
+	STAGE_WAITKEY,			// cvWaitKey(1)
+	STAGE_COUNT
+};
+
+extern const std::array<const char*, STAGE_COUNT> stageNames;
+
+// log-linear histogram of nanoseconds, 4 buckets per power of two, so a
+// percentile is within 12.5% of the true value
+class StageHistogram {
+public:
+	static const int BUCKETS = 160;
+
+	void record(int64_t ns);
+	void merge(const StageHistogram& other);
+
+	int64_t count() const { return samples; }
+	double meanMs() const { return samples ? totalNs / 1e6 / samples : 0.0; }
+	double maxMs() const { return maxNs / 1e6; }
+	double totalMs() const { return totalNs / 1e6; }
+	double percentileMs(double p) const;
+
+private:
+	int64_t samples = 0;
+	int64_t totalNs = 0;
+	int64_t maxNs = 0;
+	std::array<int64_t, BUCKETS> buckets = {};
+};
+
+class StageTimers {
+public:
+	// begin and end in cv::getTickCount() ticks
+	void record(Stage stage, int64_t beginTicks, int64_t endTicks);
+	void merge(const StageTimers& other);
+	// also sends every recorded stage to trace as a span of the current frame,
+	// the recorder is not owned, nullptr stops tracing
+	void traceTo(TraceRecorder* recorder) { trace = recorder; }
+	void traceFrame(int frame) { currentFrame = frame; }
+	const StageHistogram& operator[](Stage stage) const { return stages[stage]; }
+
+	// one line per stage that ran: count, mean, p50, p90, p99, max in ms
+	std::string summary() const;
+	std::string json() const;
+	bool writeJson(const std::string& path) const;
+
+private:
+	std::array<StageHistogram, STAGE_COUNT> stages;
+	TraceRecorder* trace = nullptr;
+	int currentFrame = -1;
+};
+
+// times its scope into timers, does nothing when timers is null
+class ScopedStage {
+public:
+	ScopedStage(StageTimers* timers, Stage stage) : timers(timers), stage(stage), start(timers ? cv::getTickCount() : 0) {}
+	~ScopedStage() { stop(); }
+	// ends the measurement before the end of the scope
+	void stop() {
+		if (timers) {
+			timers->record(stage, start, cv::getTickCount());
+			timers = nullptr;
+		}
+	}
+	ScopedStage(const ScopedStage&) = delete;
+	ScopedStage& operator=(const ScopedStage&) = delete;
+
+private:
+	StageTimers* timers;
+	Stage stage;
+	int64_t start;
+};
@@ -0,0 +1,184 @@
+// syntheticMaze.cpp : Maze rendering, the scripted / random arm visits and
+// the ground truth export.
+//
+
+#include "syntheticMaze.h"
+#include "trajectoryFile.h"
+
+#include <opencv2/imgproc.hpp>
+#include <opencv2/videoio.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <climits>
+#include <cmath>
+
+using namespace cv;
+using namespace std;
+
+SyntheticMaze::Params::Params() {
+	size = Size(640, 480);
+	fps = 30;
+	frames = 900;
+	triangle = { Point(290, 220), Point(350, 220), Point(320, 272) };
+	armLength = 180;
+	mouse = Size(36, 16);
+	speed = 4;
+	pauseFrames = 30;
+	noise = 4;
+	lighting = 0.05;
+	seed = 1;
+}
+
+SyntheticMaze::SyntheticMaze(const Params& parameters)
+	: params(parameters), rng(parameters.seed), zones(parameters.size, parameters.triangle) {
+	auto& t = params.triangle;
+	center = Point2f((t[0].x + t[1].x + t[2].x) / 3.f, (t[0].y + t[1].y + t[2].y) / 3.f);
+
+	// dark walls, a light floor: the center triangle plus one rectangle per
+	// edge, pushed outward along the edge normal
+	maze.create(params.size, CV_8UC3);
+	maze.setTo(Scalar(40, 40, 40));
+	fillConvexPoly(maze, vector<Point>(t.begin(), t.end()), Scalar(200, 200, 200));
+	array<Point2f, 3> edgeEnds;
+	unsigned foundArms = 0;
+	for (auto i = 0; i < 3; i++) {
+		Point2f v1 = t[i], v2 = t[(i + 1) % 3];
+		auto mid = (v1 + v2) * 0.5f;
+		auto normal = mid - center;
+		normal *= 1.f / max(1.f, (float)norm(normal));
+		auto reach = normal * (float)params.armLength;
+		fillConvexPoly(maze, vector<Point>{ v1, v2, v2 + reach, v1 + reach }, Scalar(200, 200, 200));
+
+		// the arm is named by the same ZoneMap the engine classifies with
+		auto end = mid + normal * (float)max(params.armLength - params.mouse.width, 0);
+		auto zone = zones.classify(end);
+		edgeEnds[i] = end;
+		if (zone >= ZONE_A && zone <= ZONE_C) {
+			armEnds[zone - ZONE_A] = end;
+			foundArms |= 1u << (zone - ZONE_A);
+		}
+	}
+	// an arm end cut off by the frame is no arm of the map, that arm then
+	// takes the end of the edge in its place, the truth still follows the map
+	for (auto i = 0; i < 3; i++) {
+		if (!(foundArms & 1u << i)) {
+			armEnds[i] = edgeEnds[i];
+		}
+	}
+	noise.create(params.size, CV_16SC3);
+
+	start = position = target = center;
+	nextWaypoint();
+}
+
+Rect SyntheticMaze::boxAt(Point2f at) const {
+	// square on the body length, like a box drawn around the mouse by hand
+	auto side = max(params.mouse.width, params.mouse.height);
+	return Rect((int)lround(at.x) - side / 2, (int)lround(at.y) - side / 2, side, side);
+}
+
+void SyntheticMaze::nextWaypoint() {
+	if (inArm) {
+		// back to the center before the next arm
+		target = center;
+		inArm = false;
+		pause = 0;
+		return;
+	}
+	int arm;
+	if (params.path.empty()) {
+		arm = rng.uniform(0, 3);
+	} else if (pathIndex < params.path.size()) {
+		arm = min(max(toupper(params.path[pathIndex++]) - 'A', 0), 2);
+	} else {
+		// the script is done, rest in the center
+		target = center;
+		pause = INT_MAX;
+		return;
+	}
+	target = armEnds[arm];
+	inArm = true;
+	pause = rng.uniform(0, params.pauseFrames + 1);
+}
+
+bool SyntheticMaze::next(Mat& image, Rect& truth, Zone& zone) {
+	if (frame >= params.frames) {
+		return false;
+	}
+	// frame 1 shows the mouse at its start, where firstBox() puts it
+	if (frame > 0) {
+		auto toTarget = target - position;
+		auto distance = (float)norm(toTarget);
+		auto step = (float)(params.speed * rng.uniform(0.7, 1.3));
+		if (distance > step) {
+			position += toTarget * (step / distance);
+			heading = atan2(toTarget.y, toTarget.x) * 180 / CV_PI;
+		} else {
+			position = target;
+			if (pause > 0) {
+				pause -= 1;
+			} else {
+				nextWaypoint();
+			}
+		}
+	}
+	frame += 1;
+
+	maze.copyTo(image);
+	// body, head towards the heading and a tail behind
+	auto radians = heading * CV_PI / 180;
+	auto forward = Point2f((float)cos(radians), (float)sin(radians));
+	auto length = (float)params.mouse.width;
+	ellipse(image, RotatedRect(position, Size2f(length, (float)params.mouse.height), (float)heading), Scalar(30, 30, 30), -1);
+	circle(image, position + forward * (length * 0.5f), params.mouse.height / 3, Scalar(30, 30, 30), -1);
+	line(image, position - forward * (length * 0.5f), position - forward * length, Scalar(60, 60, 60), 2);
+
+	if (params.lighting > 0) {
+		// one slow period every 10 seconds
+		auto gain = 1 + params.lighting * sin(2 * CV_PI * frame / (params.fps * 10));
+		image.convertTo(image, -1, gain);
+	}
+	if (params.noise > 0) {
+		rng.fill(noise, RNG::NORMAL, Scalar::all(0), Scalar::all(params.noise));
+		add(image, noise, image, noArray(), CV_8U);
+	}
+
+	truth = boxAt(position);
+	zone = zones.classify(Point((int)lround(position.x), (int)lround(position.y)));
+	return true;
+}
+
+bool writeSyntheticVideo(const SyntheticMaze::Params& params, const string& videoPath, const string& truthPath,
+	const string& truthBinPath, string* error) {
+	auto fail = [error](const string& message) {
+		if (error) {
+			*error = message;
+		}
+		return false;
+	};
+
+	VideoWriter writer(videoPath, VideoWriter::fourcc('M', 'J', 'P', 'G'), params.fps, params.size);
+	if (!writer.isOpened()) {
+		return fail("Could not open " + videoPath + " for writing");
+	}
+	SyntheticMaze maze(params);
+	Trajectory truth;
+	truth.reserve(params.frames);
+	Mat image;
+	Rect box;
+	Zone zone;
+	for (auto frame = 1; maze.next(image, box, zone); frame++) {
+		writer.write(image);
+		truth.append(frame, (frame - 1) * 1000.0 / params.fps, box, true, zone);
+	}
+	writer.release();
+
+	if (!truthPath.empty() && !truth.writeCsv(truthPath)) {
+		return fail("Could not write " + truthPath);
+	}
+	if (!truthBinPath.empty() && !writeTrajectoryFile(truthBinPath, truth, params.triangle, "TRUTH")) {
+		return fail("Could not write " + truthBinPath);
+	}
+	return true;
+}
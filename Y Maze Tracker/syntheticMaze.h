@@ -0,0 +1,66 @@
+// syntheticMaze.h : renders a Y maze with a moving mouse-shaped blob and
+// knows where the mouse is on every frame, for measuring tracker accuracy
+// without real recordings.
+//
+
+#pragma once
+
+#include "trackingEngine.h"
+#include "zoneMap.h"
+
+#include <opencv2/core.hpp>
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+class SyntheticMaze {
+public:
+	struct Params {
+		Params();
+		cv::Size size;						// frame size
+		double fps;
+		int frames;							// length of the video
+		std::array<cv::Point, 3> triangle;	// maze center, each edge opens into an arm
+		int armLength;						// from the triangle edge to the end of the arm
+		cv::Size mouse;						// body length and width
+		double speed;						// px per frame, jittered by +-30%
+		int pauseFrames;					// longest stay at the end of an arm
+		std::string path;					// arms to visit in order, e.g. "ABCAB", empty picks them at random
+		double noise;						// sigma of the per-pixel gaussian noise
+		double lighting;					// amplitude of the slow global brightness drift, 0.1 is +-10%
+		uint64_t seed;						// same seed, same video
+	};
+
+	explicit SyntheticMaze(const Params& parameters = Params());
+
+	// renders the next frame, returns false after params.frames
+	bool next(cv::Mat& frame, cv::Rect& truth, Zone& zone);
+
+	// box a tracker should be initialized with on the first frame
+	cv::Rect firstBox() const { return boxAt(start); }
+	const Params& parameters() const { return params; }
+
+private:
+	cv::Rect boxAt(cv::Point2f center) const;
+	void nextWaypoint();
+
+	Params params;
+	cv::RNG rng;
+	ZoneMap zones;
+	cv::Mat maze;							// floor and walls without the mouse
+	cv::Mat noise;
+	cv::Point2f center;						// triangle centroid
+	std::array<cv::Point2f, 3> armEnds;		// by Zone - ZONE_A
+	cv::Point2f start, position, target;
+	double heading = 0;						// degrees
+	int pause = 0;							// frames left to wait at target
+	bool inArm = false;						// target is an arm end, the next one is the center
+	size_t pathIndex = 0;
+	int frame = 0;
+};
+
+// writes the video and the ground truth trajectory (csv and / or binary,
+// either path may be empty), error says why on failure
+bool writeSyntheticVideo(const SyntheticMaze::Params& params, const std::string& videoPath,
+	const std::string& truthPath, const std::string& truthBinPath, std::string* error = nullptr);
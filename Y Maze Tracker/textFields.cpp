@@ -0,0 +1,42 @@
+// textFields.cpp : Comma separated integer lists and json string escaping.
+//
+
+#include "textFields.h"
+
+#include <cstdio>
+#include <sstream>
+#include <stdexcept>
+
+using namespace std;
+
+vector<int> parseInts(const string& text) {
+	vector<int> values;
+	stringstream ss(text);
+	string item;
+	while (getline(ss, item, ',')) {
+		try {
+			values.push_back(stoi(item));
+		} catch (const exception&) {
+			return {};
+		}
+	}
+	return values;
+}
+
+string jsonEscape(const string& text) {
+	string escaped;
+	for (auto c : text) {
+		if (c == '\\' || c == '"') {
+			escaped += '\\';
+			escaped += c;
+		} else if ((unsigned char)c < 0x20) {
+			// control characters are never valid raw inside a string
+			char code[8];
+			snprintf(code, sizeof(code), "\\u%04x", (unsigned char)c);
+			escaped += code;
+		} else {
+			escaped += c;
+		}
+	}
+	return escaped;
+}
@@ -0,0 +1,15 @@
+// textFields.h : parsing of the short text values the command line tools
+// take and quoting of the ones they write, shared so every tool accepts and
+// writes the same syntax.
+//
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+// a comma separated list of integers, empty if any item is not one
+std::vector<int> parseInts(const std::string& text);
+
+// text as the inside of a json string, for paths with backslashes and quotes
+std::string jsonEscape(const std::string& text);
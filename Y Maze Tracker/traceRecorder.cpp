@@ -0,0 +1,115 @@
+// traceRecorder.cpp : Double-buffered trace-event writer.
+//
+
+#include "traceRecorder.h"
+#include "textFields.h"
+
+#include <opencv2/core.hpp>
+
+#include <atomic>
+
+using namespace cv;
+using namespace std;
+
+TraceRecorder::TraceRecorder(const string& path, size_t blockEvents)
+	: origin(getTickCount()), usPerTick(1e6 / getTickFrequency()), blockEvents(max<size_t>(blockEvents, 64)) {
+	file = fopen(path.c_str(), "wb");
+	if (!file) {
+		return;
+	}
+	active.reserve(this->blockEvents);
+	writing.reserve(this->blockEvents);
+	fputs("{\"traceEvents\":[\n", file);
+	worker = thread(&TraceRecorder::writeLoop, this);
+}
+
+TraceRecorder::~TraceRecorder() {
+	close();
+}
+
+// small sequential ids read better in the viewer than hashed thread ids
+uint32_t TraceRecorder::threadId() {
+	static atomic<uint32_t> next = 1;
+	thread_local uint32_t id = next++;
+	return id;
+}
+
+void TraceRecorder::span(const char* name, int64_t beginTicks, int64_t endTicks, int frame) {
+	if (!file) {
+		return;
+	}
+	Event event{ name, beginTicks, endTicks, threadId(), frame };
+	lock_guard<mutex> lock(traceMutex);
+	if (active.size() >= blockEvents) {
+		if (writePending) {
+			// the writer is behind, drop rather than block the pipeline
+			droppedEvents += 1;
+			return;
+		}
+		swap(active, writing);
+		writePending = true;
+		changed.notify_all();
+	}
+	active.push_back(event);
+}
+
+void TraceRecorder::nameThread(const string& name) {
+	if (!file) {
+		return;
+	}
+	lock_guard<mutex> lock(traceMutex);
+	threadNames[threadId()] = name;
+}
+
+void TraceRecorder::writeEvents(const vector<Event>& events) {
+	for (auto& event : events) {
+		fprintf(file, "%s{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u", firstEvent ? "" : ",\n",
+			event.name, (event.begin - origin) * usPerTick, (event.end - event.begin) * usPerTick, event.thread);
+		if (event.frame >= 0) {
+			fprintf(file, ",\"args\":{\"frame\":%d}", event.frame);
+		}
+		fputc('}', file);
+		firstEvent = false;
+	}
+}
+
+void TraceRecorder::writeLoop() {
+	unique_lock<mutex> lock(traceMutex);
+	for (;;) {
+		changed.wait(lock, [this] { return writePending || stopping; });
+		if (!writePending) {
+			break;
+		}
+		// writing belongs to this thread until writePending is cleared
+		lock.unlock();
+		writeEvents(writing);
+		lock.lock();
+		writing.clear();
+		writePending = false;
+		changed.notify_all();
+	}
+}
+
+void TraceRecorder::close() {
+	if (!file) {
+		return;
+	}
+	{
+		lock_guard<mutex> lock(traceMutex);
+		stopping = true;
+	}
+	changed.notify_all();
+	worker.join();
+
+	// the writer is gone, the rest is written from here
+	writeEvents(active);
+	active.clear();
+	for (auto& [id, label] : threadNames) {
+		fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+			firstEvent ? "" : ",\n", id, jsonEscape(label).c_str());
+		firstEvent = false;
+	}
+	fprintf(file, "\n],\"displayTimeUnit\":\"ms\",\"otherData\":{\"dropped_events\":%zu}}\n", droppedEvents);
+	fclose(file);
+	file = nullptr;
+}
@@ -0,0 +1,64 @@
+// traceRecorder.h : per-frame spans of the pipeline threads written as Chrome
+// trace-event json (chrome://tracing, Perfetto), buffered in bounded blocks
+// that a background thread formats and writes.
+//
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class TraceRecorder {
+public:
+	// blockEvents spans are buffered before a block is handed to the writer,
+	// with one block being written spans beyond that are dropped and counted
+	explicit TraceRecorder(const std::string& path, size_t blockEvents = 1 << 14);
+	~TraceRecorder();
+	TraceRecorder(const TraceRecorder&) = delete;
+	TraceRecorder& operator=(const TraceRecorder&) = delete;
+
+	bool isOpen() const { return file != nullptr; }
+
+	// a complete span on the calling thread, cv::getTickCount() ticks, name
+	// must outlive the recorder (a literal or stageNames), frame -1 for none
+	void span(const char* name, int64_t beginTicks, int64_t endTicks, int frame = -1);
+	// label of the calling thread in the viewer
+	void nameThread(const std::string& name);
+
+	// writes everything buffered and terminates the json
+	void close();
+	size_t dropped() const { return droppedEvents; }
+
+private:
+	struct Event {
+		const char* name;
+		int64_t begin, end;
+		uint32_t thread;
+		int frame;
+	};
+
+	static uint32_t threadId();
+	void writeLoop();
+	void writeEvents(const std::vector<Event>& events);
+
+	FILE* file = nullptr;
+	int64_t origin;						// ticks at construction, the trace starts at 0
+	double usPerTick;
+	size_t blockEvents;
+	std::vector<Event> active;			// filled by span()
+	std::vector<Event> writing;			// being written by the writer thread
+	bool writePending = false;
+	bool stopping = false;
+	bool firstEvent = true;
+	size_t droppedEvents = 0;
+	std::map<uint32_t, std::string> threadNames;
+	std::mutex traceMutex;
+	std::condition_variable changed;
+	std::thread worker;
+};
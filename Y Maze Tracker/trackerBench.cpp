@@ -0,0 +1,418 @@
+// trackerBench.cpp : Throughput benchmark of every tracker type over a set of
+// reference clips, printed as a csv or json table for comparing builds.
+//
+
+#include "trackingEngine.h"
+#include "jobScheduler.h"
+#include "medianBackground.h"
+#include "showConvert.h"
+#include "textFields.h"
+
+#include <opencv2/core/utility.hpp>
+#include <opencv2/imgproc.hpp>
+#include <opencv2/videoio.hpp>
+#include <opencv2/video/background_segm.hpp>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <fstream>
+#endif
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace cv;
+using namespace std;
+
+const auto keys =
+	"{help h   |          | print this message }"
+	"{clips c  |          | reference clips, a job list (see README), the tracker keys are ignored }"
+	"{trackers |          | comma separated tracker types, all of them by default }"
+	"{preset   | balanced | fast, balanced, accurate or one from --presets }"
+	"{presets  |          | FileStorage file with more presets }"
+	"{frames   | 300      | frames tracked per clip, 0 for the whole clip }"
+	"{mog2     | both     | run the MOG2 stage: on, off or both }"
+	"{display  |          | also time the preview conversion of each clip, fused against cvtColor + flip }"
+	"{check    |          | compare the optimized kernels with their reference versions on random images and exit, moments or show for one }"
+	"{format   | csv      | csv or json }"
+	"{output o | -        | table file, - for stdout }";
+
+struct BenchResult {
+	string clip, tracker;
+	bool mog2 = false;
+	int frames = 0;
+	int failures = 0;
+	double initMs = 0;						// tracker creation and init, MEDIANBG includes its background
+	double p50Ms = 0, p90Ms = 0, p99Ms = 0, maxMs = 0;	// per-frame latency of update and MOG2
+	double fps = 0;							// frames over the summed latencies, decoding excluded
+	long long peakRssKb = 0;				// process peak resident set during the run
+};
+
+// the peak is reset before each run where the OS allows it, Windows only
+// reports the peak of the whole process
+void resetPeakRss() {
+#ifndef _WIN32
+	ofstream("/proc/self/clear_refs") << "5";
+#endif
+}
+
+long long peakRssKb() {
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+		return (long long)(counters.PeakWorkingSetSize / 1024);
+	}
+	return 0;
+#else
+	ifstream status("/proc/self/status");
+	string line;
+	while (getline(status, line)) {
+		if (line.compare(0, 6, "VmHWM:") == 0) {
+			return stoll(line.substr(6));
+		}
+	}
+	return 0;
+#endif
+}
+
+double percentile(vector<double>& values, double p) {
+	if (values.empty()) {
+		return 0;
+	}
+	auto nth = values.begin() + (size_t)(p * (values.size() - 1) + 0.5);
+	nth_element(values.begin(), nth, values.end());
+	return *nth;
+}
+
+// tracks the first frames of one clip, false if the tracker could not be created
+bool benchmark(const TrackingSession& clip, const string& type, bool mog2, int maxFrames, BenchResult& result) {
+	VideoCapture cap(clip.videoPath);
+	Mat frame, fgMask;
+	if (!cap.isOpened() || !cap.read(frame) || frame.empty()) {
+		return false;
+	}
+	resetPeakRss();
+
+	auto start = getTickCount();
+	Ptr<Tracker> tracker;
+	if (type == "MEDIANBG") {
+		Mat background;
+		if (buildMedianBackground(clip.videoPath, clip.backgroundSamples, background)) {
+			tracker = TrackerMedianBackground::create(background, clip.trackerParams.medianBackground);
+		}
+	} else {
+		tracker = createTracker(type, clip.trackerParams);
+	}
+	if (!tracker) {
+		return false;
+	}
+	Ptr<BackgroundSubtractor> pBackSub;
+	if (mog2) {
+		pBackSub = createBackgroundSubtractorMOG2();
+	}
+	auto bbox = clip.bbox;
+	tracker->init(frame, bbox);
+	result.initMs = (getTickCount() - start) * 1000.0 / getTickFrequency();
+
+	vector<double> latencies;
+	latencies.reserve(maxFrames > 0 ? maxFrames : 1024);
+	double total = 0;
+	do {
+		auto tick = getTickCount();
+		if (pBackSub) {
+			pBackSub->apply(frame, fgMask);
+		}
+		if (!tracker->update(frame, bbox)) {
+			result.failures += 1;
+		}
+		auto ms = (getTickCount() - tick) * 1000.0 / getTickFrequency();
+		latencies.push_back(ms);
+		total += ms;
+	} while ((maxFrames <= 0 || (int)latencies.size() < maxFrames) && cap.read(frame) && !frame.empty());
+
+	result.clip = clip.videoPath;
+	result.tracker = type;
+	result.mog2 = mog2;
+	result.frames = (int)latencies.size();
+	result.fps = total > 0 ? result.frames * 1000.0 / total : 0;
+	result.maxMs = *max_element(latencies.begin(), latencies.end());
+	result.p50Ms = percentile(latencies, 0.5);
+	result.p90Ms = percentile(latencies, 0.9);
+	result.p99Ms = percentile(latencies, 0.99);
+	result.peakRssKb = peakRssKb();
+	return true;
+}
+
+// ms per frame of turning the first frame into a bottom-up DIB, the way the
+// Windows preview did it and with the fused kernel
+bool benchmarkDisplay(const TrackingSession& clip, double& separateMs, double& fusedMs) {
+	VideoCapture cap(clip.videoPath);
+	Mat frame;
+	if (!cap.isOpened() || !cap.read(frame) || frame.empty()) {
+		return false;
+	}
+	const int runs = 200;
+	const auto step = (size_t)((frame.cols * 3 + 3) & -4);
+	vector<uchar> dib(step * frame.rows);
+	Mat dst(frame.rows, frame.cols, CV_8UC3, dib.data(), step);
+	auto start = getTickCount();
+	for (auto i = 0; i < runs; i++) {
+		cvtColor(frame, dst, COLOR_BGRA2BGR, 3);
+		flip(dst, dst, 0);
+	}
+	separateMs = (getTickCount() - start) * 1000.0 / getTickFrequency() / runs;
+	start = getTickCount();
+	for (auto i = 0; i < runs; i++) {
+		convertToShowFlipped(frame, dib.data(), step);
+	}
+	fusedMs = (getTickCount() - start) * 1000.0 / getTickFrequency() / runs;
+	return true;
+}
+
+// the dispatched foreground kernel against the scalar one, over widths on both
+// sides of the 32 pixel vectors and thresholds outside the byte range
+int checkForegroundMoments(RNG& rng) {
+	int failed = 0;
+	for (auto run = 0; run < 200; run++) {
+		auto size = run < 100 ? Size(1 + run, 1 + run % 7) : Size(rng.uniform(1, 700), rng.uniform(1, 60));
+		Mat gray(size, CV_8UC1), background(size, CV_8UC1);
+		rng.fill(gray, RNG::UNIFORM, 0, 256);
+		rng.fill(background, RNG::UNIFORM, 0, 256);
+		const int edges[] = { -300, -2, -1, 0, 1, 127, 128, 254, 255, 256 };
+		auto thresh = run < 10 ? edges[run] : rng.uniform(-300, 300);
+		ForegroundMoments fast, reference;
+		foregroundMoments(gray, background, thresh, fast);
+		foregroundMomentsScalar(gray, background, thresh, reference);
+		if (fast.count != reference.count || fast.sumX != reference.sumX || fast.sumY != reference.sumY) {
+			fprintf(stderr, "foregroundMoments %dx%d thresh %d: %lld %lld %lld, scalar %lld %lld %lld\n", size.width, size.height, thresh,
+				(long long)fast.count, (long long)fast.sumX, (long long)fast.sumY,
+				(long long)reference.count, (long long)reference.sumX, (long long)reference.sumY);
+			failed += 1;
+		}
+	}
+	return failed;
+}
+
+// convertToShow of the Win32 window into a BGR bitmap followed by the flip,
+// what convertToShowFlipped replaced
+void convertToShowReference(const Mat& src, Mat& dst) {
+	Mat tmp;
+	switch (src.depth()) {
+	case CV_8U:
+		tmp = src;
+		break;
+	case CV_8S:
+		convertScaleAbs(src, tmp, 1, 127);
+		break;
+	case CV_16S:
+		convertScaleAbs(src, tmp, 1 / 255., 127);
+		break;
+	case CV_16U:
+		convertScaleAbs(src, tmp, 1 / 255.);
+		break;
+	default:
+		src.convertTo(tmp, CV_8U, 255., 0.);
+		break;
+	}
+	if (tmp.channels() == 1) {
+		cvtColor(tmp, dst, COLOR_GRAY2BGR);
+	} else {
+		cvtColor(tmp, dst, COLOR_BGRA2BGR, 3);
+	}
+	flip(dst, dst, 0);
+}
+
+// the fused preview conversion against the reference, for every channel
+// count on 8 bits and for the other depths, at widths around the 16 pixel
+// vectors and the 4 byte bitmap row alignment
+int checkShowConvert(RNG& rng) {
+	int failed = 0;
+	const int types[] = { CV_8UC1, CV_8UC3, CV_8UC4, CV_8SC3, CV_16UC3, CV_16SC1, CV_32FC3, CV_64FC4 };
+	for (auto type : types) {
+		for (auto run = 0; run < 20; run++) {
+			auto size = run < 10 ? Size(13 + run, 3 + run) : Size(rng.uniform(1, 400), rng.uniform(1, 50));
+			// the whole range of each depth, floating point is shown as 0..1
+			Mat src(size, type);
+			switch (CV_MAT_DEPTH(type)) {
+			case CV_8U:
+				rng.fill(src, RNG::UNIFORM, 0, 256);
+				break;
+			case CV_8S:
+				rng.fill(src, RNG::UNIFORM, -128, 128);
+				break;
+			case CV_16U:
+				rng.fill(src, RNG::UNIFORM, 0, 65536);
+				break;
+			case CV_16S:
+				rng.fill(src, RNG::UNIFORM, -32768, 32768);
+				break;
+			default:
+				rng.fill(src, RNG::UNIFORM, 0, 1);
+				break;
+			}
+			Mat reference;
+			convertToShowReference(src, reference);
+			const auto step = (size_t)((size.width * 3 + 3) & -4);
+			vector<uchar> dib(step * size.height);
+			convertToShowFlipped(src, dib.data(), step);
+			for (auto y = 0; y < size.height; y++) {
+				if (memcmp(dib.data() + y * step, reference.ptr<uchar>(y), (size_t)size.width * 3) != 0) {
+					fprintf(stderr, "convertToShowFlipped type %d %dx%d differs at row %d\n", type, size.width, size.height, y);
+					failed += 1;
+					break;
+				}
+			}
+		}
+	}
+	return failed;
+}
+
+void writeTable(FILE* file, const vector<BenchResult>& results, bool json) {
+	if (json) {
+		fputs("[\n", file);
+	} else {
+		fputs("clip,tracker,mog2,frames,failures,init_ms,p50_ms,p90_ms,p99_ms,max_ms,fps,peak_rss_kb\n", file);
+	}
+	for (size_t i = 0; i < results.size(); i++) {
+		auto& r = results[i];
+		if (json) {
+			fprintf(file, "  {\"clip\":\"%s\",\"tracker\":\"%s\",\"mog2\":%s,\"frames\":%d,\"failures\":%d,\"init_ms\":%.3f,"
+				"\"p50_ms\":%.3f,\"p90_ms\":%.3f,\"p99_ms\":%.3f,\"max_ms\":%.3f,\"fps\":%.1f,\"peak_rss_kb\":%lld}%s\n",
+				jsonEscape(r.clip).c_str(), r.tracker.c_str(), r.mog2 ? "true" : "false", r.frames, r.failures, r.initMs,
+				r.p50Ms, r.p90Ms, r.p99Ms, r.maxMs, r.fps, r.peakRssKb, i + 1 < results.size() ? "," : "");
+		} else {
+			fprintf(file, "%s,%s,%d,%d,%d,%.3f,%.3f,%.3f,%.3f,%.3f,%.1f,%lld\n", r.clip.c_str(), r.tracker.c_str(),
+				r.mog2 ? 1 : 0, r.frames, r.failures, r.initMs, r.p50Ms, r.p90Ms, r.p99Ms, r.maxMs, r.fps, r.peakRssKb);
+		}
+	}
+	if (json) {
+		fputs("]\n", file);
+	}
+}
+
+int main(int argc, char** argv) {
+	CommandLineParser parser(argc, argv, keys);
+	parser.about("Y Maze Tracker tracker benchmark");
+	if (parser.has("help")) {
+		parser.printMessage();
+		return 0;
+	}
+	auto clipsPath = parser.get<string>("clips");
+	auto mog2 = parser.get<string>("mog2");
+	auto format = parser.get<string>("format");
+	auto outputPath = parser.get<string>("output");
+	auto maxFrames = parser.get<int>("frames");
+	if (parser.has("check")) {
+		// a bare --check runs both. A kernel the cpu cannot run is reported as
+		// skipped, 77 when nothing was left to check, which ctest counts as skipped
+		auto which = parser.get<string>("check");
+		auto all = which == "true";
+		if (!all && which != "moments" && which != "show") {
+			fprintf(stderr, "Unknown kernel %s\n", which.c_str());
+			return 1;
+		}
+		RNG rng(20240611);
+		int failed = 0, checked = 0;
+		auto report = [&](const char* name, int failures) {
+			fprintf(stderr, "%s: %s\n", name, failures ? "failed" : "passed");
+			failed += failures;
+			checked += 1;
+		};
+		if (all || which == "moments") {
+			if (foregroundMomentsAccelerated()) {
+				report("foregroundMoments", checkForegroundMoments(rng));
+			} else {
+				fprintf(stderr, "foregroundMoments: skipped, no AVX2 on this cpu\n");
+			}
+		}
+		if (all || which == "show") {
+			report("convertToShowFlipped", checkShowConvert(rng));
+		}
+		return failed ? 1 : checked ? 0 : 77;
+	}
+	if (!parser.check() || clipsPath.empty() || (mog2 != "on" && mog2 != "off" && mog2 != "both") ||
+		(format != "csv" && format != "json")) {
+		parser.printErrors();
+		parser.printMessage();
+		return 1;
+	}
+
+	TrackerPresets presets;
+	string error;
+	if (parser.has("presets") && !presets.load(parser.get<string>("presets"), &error)) {
+		fprintf(stderr, "%s\n", error.c_str());
+		return 1;
+	}
+	vector<TrackingSession> clips;
+	if (!loadJobs(clipsPath, clips, presets, &error)) {
+		fprintf(stderr, "%s\n", error.c_str());
+		return 1;
+	}
+	TrackerPreset preset;
+	if (!presets.find(parser.get<string>("preset"), preset)) {
+		fprintf(stderr, "Unknown preset %s\n", parser.get<string>("preset").c_str());
+		return 1;
+	}
+
+	vector<string> types(trackerNames.begin(), trackerNames.end());
+	if (parser.has("trackers")) {
+		types.clear();
+		stringstream ss(parser.get<string>("trackers"));
+		string type;
+		while (getline(ss, type, ',')) {
+			types.push_back(type);
+		}
+	}
+
+	vector<BenchResult> results;
+	for (auto clip : clips) {
+		clip.trackerParams = preset;
+		double separateMs, fusedMs;
+		if (parser.has("display") && benchmarkDisplay(clip, separateMs, fusedMs)) {
+			fprintf(stderr, "%s: display %.3f ms cvtColor + flip, %.3f ms fused\n", clip.videoPath.c_str(), separateMs, fusedMs);
+		}
+		for (auto& type : types) {
+			// the background trackers never run MOG2 in the engine
+			auto backgroundTracker = type == "BACKSUB" || type == "MEDIANBG";
+			for (auto withMog2 : { false, true }) {
+				if ((withMog2 && (mog2 == "off" || backgroundTracker)) || (!withMog2 && mog2 == "on")) {
+					continue;
+				}
+				BenchResult result;
+				bool ok = false;
+				try {
+					ok = benchmark(clip, type, withMog2, maxFrames, result);
+				} catch (const Exception& e) {
+					// GOTURN and DaSiamRPN throw without their model files
+					error = e.what();
+				}
+				if (!ok) {
+					fprintf(stderr, "%s: skipped %s%s\n", clip.videoPath.c_str(), type.c_str(), error.empty() ? "" : (", " + error).c_str());
+					error.clear();
+					continue;
+				}
+				fprintf(stderr, "%s: %s%s %.1f fps\n", clip.videoPath.c_str(), type.c_str(), withMog2 ? "+MOG2" : "", result.fps);
+				results.push_back(result);
+			}
+		}
+	}
+
+	auto file = outputPath == "-" ? stdout : fopen(outputPath.c_str(), "w");
+	if (!file) {
+		fprintf(stderr, "Could not open %s for writing\n", outputPath.c_str());
+		return 1;
+	}
+	writeTable(file, results, format == "json");
+	if (file != stdout && fclose(file) != 0) {
+		fprintf(stderr, "Could not write %s\n", outputPath.c_str());
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,158 @@
+// trackerEval.cpp : Runs one tracker configuration over labeled clips and
+// reports its accuracy against the ground truth next to its frame rate.
+//
+
+#include "trackingEngine.h"
+#include "jobScheduler.h"
+#include "evaluation.h"
+#include "textFields.h"
+
+#include <opencv2/core/utility.hpp>
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace cv;
+using namespace std;
+
+const auto keys =
+	"{help h       |     | print this message }"
+	"{clips c      |     | labeled clips, a job list (see README) with a truth trajectory per job }"
+	"{tracker      |     | tracker type for every clip instead of the one in the list }"
+	"{preset       |     | preset for every clip instead of the one in the list }"
+	"{presets      |     | FileStorage file with more presets }"
+	"{backsub      |     | enable background subtraction }"
+	"{reacquire    |     | re-init the tracker on the largest foreground blob after a failure }"
+	"{kalman       |     | track inside a Kalman predicted search window }"
+	"{format       | csv | csv or json }"
+	"{output o     | -   | table file, - for stdout }";
+
+struct EvalRow {
+	string clip, tracker;
+	Accuracy accuracy;
+	double fps = 0;
+};
+
+void writeRow(FILE* file, const EvalRow& row, bool json, bool last) {
+	auto& a = row.accuracy;
+	if (json) {
+		fprintf(file, "  {\"clip\":\"%s\",\"tracker\":\"%s\",\"frames\":%d,\"failures\":%d,\"fps\":%.1f,\"mean_iou\":%.4f,"
+			"\"success_rate\":%.4f,\"mean_center_error\":%.2f,\"max_center_error\":%.2f,\"zone_agreement\":%.4f}%s\n",
+			jsonEscape(row.clip).c_str(), row.tracker.c_str(), a.frames, a.failures(), row.fps, a.meanIoU(), a.successRate(),
+			a.meanCenterError(), a.maxCenterError, a.zoneAgreement(), last ? "" : ",");
+	} else {
+		fprintf(file, "%s,%s,%d,%d,%.1f,%.4f,%.4f,%.2f,%.2f,%.4f\n", row.clip.c_str(), row.tracker.c_str(), a.frames,
+			a.failures(), row.fps, a.meanIoU(), a.successRate(), a.meanCenterError(), a.maxCenterError, a.zoneAgreement());
+	}
+}
+
+int main(int argc, char** argv) {
+	CommandLineParser parser(argc, argv, keys);
+	parser.about("Y Maze Tracker accuracy evaluation");
+	if (parser.has("help")) {
+		parser.printMessage();
+		return 0;
+	}
+	auto clipsPath = parser.get<string>("clips");
+	auto format = parser.get<string>("format");
+	auto outputPath = parser.get<string>("output");
+	if (!parser.check() || clipsPath.empty() || (format != "csv" && format != "json")) {
+		parser.printErrors();
+		parser.printMessage();
+		return 1;
+	}
+
+	TrackerPresets presets;
+	string error;
+	if (parser.has("presets") && !presets.load(parser.get<string>("presets"), &error)) {
+		fprintf(stderr, "%s\n", error.c_str());
+		return 1;
+	}
+	vector<TrackingSession> clips;
+	if (!loadJobs(clipsPath, clips, presets, &error)) {
+		fprintf(stderr, "%s\n", error.c_str());
+		return 1;
+	}
+	TrackerPreset preset;
+	if (parser.has("preset") && !presets.find(parser.get<string>("preset"), preset)) {
+		fprintf(stderr, "Unknown preset %s\n", parser.get<string>("preset").c_str());
+		return 1;
+	}
+
+	vector<EvalRow> rows;
+	Accuracy total;
+	long long totalFrames = 0;
+	double totalSeconds = 0;
+	for (size_t i = 0; i < clips.size(); i++) {
+		auto session = clips[i];
+		if (session.truthPath.empty()) {
+			fprintf(stderr, "%s: no truth, skipped\n", session.videoPath.c_str());
+			continue;
+		}
+		Trajectory truth;
+		if (!readTrajectory(session.truthPath, truth, &error)) {
+			fprintf(stderr, "%s: %s\n", session.videoPath.c_str(), error.c_str());
+			return 1;
+		}
+		if (parser.has("tracker")) {
+			session.trackerType = parser.get<string>("tracker");
+		}
+		if (parser.has("preset")) {
+			session.trackerParams = preset;
+		}
+		session.useBackSub = session.useBackSub || parser.has("backsub");
+		session.reacquire = session.reacquire || parser.has("reacquire");
+		session.predictWindow = session.predictWindow || parser.has("kalman");
+		// only the trajectory in memory is compared, nothing is written
+		session.trajectoryPath.clear();
+		session.trajectoryBinPath.clear();
+		session.resultsPath.clear();
+		session.checkpointPath.clear();
+
+		TrackingResult result;
+		if (!runTracking(session, result, nullptr, &error)) {
+			fprintf(stderr, "%s: %s\n", session.videoPath.c_str(), error.c_str());
+			return 1;
+		}
+		EvalRow row;
+		row.clip = session.videoPath;
+		row.tracker = session.trackerType;
+		row.accuracy = compareTrajectories(result.trajectory, truth);
+		row.fps = result.seconds > 0 ? result.frames / result.seconds : 0;
+		rows.push_back(row);
+		total += row.accuracy;
+		totalFrames += result.frames;
+		totalSeconds += result.seconds;
+	}
+	if (rows.empty()) {
+		fprintf(stderr, "No clip of %s has a truth trajectory\n", clipsPath.c_str());
+		return 1;
+	}
+	// every clip weighted by its frames
+	EvalRow all;
+	all.clip = "ALL";
+	all.tracker = rows.front().tracker;
+	all.accuracy = total;
+	all.fps = totalSeconds > 0 ? totalFrames / totalSeconds : 0;
+	rows.push_back(all);
+
+	auto file = outputPath == "-" ? stdout : fopen(outputPath.c_str(), "w");
+	if (!file) {
+		fprintf(stderr, "Could not open %s for writing\n", outputPath.c_str());
+		return 1;
+	}
+	auto json = format == "json";
+	fputs(json ? "[\n" : "clip,tracker,frames,failures,fps,mean_iou,success_rate,mean_center_error,max_center_error,zone_agreement\n", file);
+	for (size_t i = 0; i < rows.size(); i++) {
+		writeRow(file, rows[i], json, i + 1 == rows.size());
+	}
+	if (json) {
+		fputs("]\n", file);
+	}
+	if (file != stdout && fclose(file) != 0) {
+		fprintf(stderr, "Could not write %s\n", outputPath.c_str());
+		return 1;
+	}
+	return 0;
+}
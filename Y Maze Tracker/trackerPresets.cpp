@@ -0,0 +1,318 @@
+// trackerPresets.cpp : The built in presets and their FileStorage overrides.
+//
+
+#include "trackerPresets.h"
+
+#include <cstdint>
+#include <cstdio>
+
+using namespace cv;
+using namespace std;
+
+template <class T> static void readField(const FileNode& node, const char* name, T& value) {
+	if (!node[name].empty()) {
+		node[name] >> value;
+	}
+}
+
+// FileStorage has no bool or Size, they are stored as 0 / 1 and [w, h]
+static void readField(const FileNode& node, const char* name, bool& value) {
+	if (!node[name].empty()) {
+		value = (int)node[name] != 0;
+	}
+}
+
+static void readField(const FileNode& node, const char* name, Size& value) {
+	vector<int> size;
+	readField(node, name, size);
+	if (size.size() == 2) {
+		value = Size(size[0], size[1]);
+	}
+}
+
+template <class T> static void writeField(FileStorage& fs, const char* name, const T& value) {
+	fs << name << value;
+}
+
+static void writeField(FileStorage& fs, const char* name, bool value) {
+	fs << name << (int)value;
+}
+
+static void writeField(FileStorage& fs, const char* name, const Size& value) {
+	fs << name << vector<int>{ value.width, value.height };
+}
+
+// what the trackers ran with before presets: the OpenCV defaults, except
+// that CSRT had color names turned on, which OpenCV leaves off
+TrackerPreset::TrackerPreset() {
+	csrt.use_color_names = true;
+}
+
+// roughly 2-5x the frame rate of balanced, for a mouse that is large and
+// contrasted against a plain floor
+TrackerPreset TrackerPreset::fast() {
+	TrackerPreset preset;
+	preset.csrt.use_color_names = false;
+	preset.csrt.use_segmentation = false;
+	preset.csrt.template_size = 100;
+	preset.csrt.number_of_scales = 17;
+	preset.csrt.admm_iterations = 2;
+	preset.kcf.max_patch_size = 40 * 40;
+	preset.kcf.compressed_size = 1;
+	preset.mil.samplerSearchWinSize = 15;
+	preset.mil.samplerTrackMaxNegNum = 30;
+	preset.mil.featureSetNumFeatures = 100;
+	preset.boosting.numClassifiers = 50;
+	preset.boosting.samplerSearchFactor = 1.5f;
+	preset.boosting.featureSetNumFeatures = 500;
+	preset.medianFlow.pointsInGrid = 6;
+	preset.medianFlow.maxLevel = 3;
+	preset.backSub.scale = 0.25;
+	return preset;
+}
+
+// slower than balanced, for dim or cluttered recordings
+TrackerPreset TrackerPreset::accurate() {
+	TrackerPreset preset;
+	preset.csrt.template_size = 250;
+	preset.csrt.admm_iterations = 6;
+	preset.kcf.max_patch_size = 120 * 120;
+	preset.kcf.compressed_size = 4;
+	preset.mil.samplerSearchWinSize = 35;
+	preset.mil.featureSetNumFeatures = 400;
+	preset.boosting.numClassifiers = 150;
+	preset.boosting.featureSetNumFeatures = 1500;
+	preset.medianFlow.pointsInGrid = 15;
+	preset.backSub.scale = 1;
+	return preset;
+}
+
+void TrackerPreset::read(const FileNode& node) {
+	auto n = node["CSRT"];
+	readField(n, "use_hog", csrt.use_hog);
+	readField(n, "use_color_names", csrt.use_color_names);
+	readField(n, "use_gray", csrt.use_gray);
+	readField(n, "use_rgb", csrt.use_rgb);
+	readField(n, "use_channel_weights", csrt.use_channel_weights);
+	readField(n, "use_segmentation", csrt.use_segmentation);
+	readField(n, "window_function", csrt.window_function);
+	readField(n, "template_size", csrt.template_size);
+	readField(n, "padding", csrt.padding);
+	readField(n, "filter_lr", csrt.filter_lr);
+	readField(n, "num_hog_channels_used", csrt.num_hog_channels_used);
+	readField(n, "admm_iterations", csrt.admm_iterations);
+	readField(n, "histogram_bins", csrt.histogram_bins);
+	readField(n, "number_of_scales", csrt.number_of_scales);
+	readField(n, "scale_step", csrt.scale_step);
+	readField(n, "psr_threshold", csrt.psr_threshold);
+
+	n = node["KCF"];
+	readField(n, "detect_thresh", kcf.detect_thresh);
+	readField(n, "sigma", kcf.sigma);
+	readField(n, "interp_factor", kcf.interp_factor);
+	readField(n, "resize", kcf.resize);
+	readField(n, "compress_feature", kcf.compress_feature);
+	readField(n, "max_patch_size", kcf.max_patch_size);
+	readField(n, "compressed_size", kcf.compressed_size);
+	readField(n, "desc_pca", kcf.desc_pca);
+	readField(n, "desc_npca", kcf.desc_npca);
+
+	n = node["MIL"];
+	readField(n, "sampler_init_in_radius", mil.samplerInitInRadius);
+	readField(n, "sampler_init_max_neg_num", mil.samplerInitMaxNegNum);
+	readField(n, "sampler_search_win_size", mil.samplerSearchWinSize);
+	readField(n, "sampler_track_in_radius", mil.samplerTrackInRadius);
+	readField(n, "sampler_track_max_pos_num", mil.samplerTrackMaxPosNum);
+	readField(n, "sampler_track_max_neg_num", mil.samplerTrackMaxNegNum);
+	readField(n, "feature_set_num_features", mil.featureSetNumFeatures);
+
+	n = node["GOTURN"];
+	readField(n, "model_txt", goturn.modelTxt);
+	readField(n, "model_bin", goturn.modelBin);
+
+	n = node["DaSiamRPN"];
+	readField(n, "model", daSiamRPN.model);
+	readField(n, "kernel_cls1", daSiamRPN.kernel_cls1);
+	readField(n, "kernel_r1", daSiamRPN.kernel_r1);
+	readField(n, "backend", daSiamRPN.backend);
+	readField(n, "target", daSiamRPN.target);
+
+	n = node["BOOSTING"];
+	readField(n, "num_classifiers", boosting.numClassifiers);
+	readField(n, "sampler_overlap", boosting.samplerOverlap);
+	readField(n, "sampler_search_factor", boosting.samplerSearchFactor);
+	readField(n, "iteration_init", boosting.iterationInit);
+	readField(n, "feature_set_num_features", boosting.featureSetNumFeatures);
+
+	n = node["MEDIANFLOW"];
+	readField(n, "points_in_grid", medianFlow.pointsInGrid);
+	readField(n, "win_size", medianFlow.winSize);
+	readField(n, "max_level", medianFlow.maxLevel);
+	readField(n, "win_size_ncc", medianFlow.winSizeNCC);
+	readField(n, "max_median_displacement_difference", medianFlow.maxMedianLengthOfDisplacementDifference);
+
+	n = node["BACKSUB"];
+	readField(n, "history", backSub.history);
+	readField(n, "var_threshold", backSub.varThreshold);
+	readField(n, "learning_rate", backSub.learningRate);
+	readField(n, "scale", backSub.scale);
+	readField(n, "open_kernel", backSub.openKernel);
+	readField(n, "min_area", backSub.minArea);
+
+	n = node["MEDIANBG"];
+	readField(n, "threshold", medianBackground.threshold);
+	readField(n, "min_area", medianBackground.minArea);
+}
+
+void TrackerPreset::write(FileStorage& fs) const {
+	fs << "CSRT" << "{";
+	writeField(fs, "use_hog", csrt.use_hog);
+	writeField(fs, "use_color_names", csrt.use_color_names);
+	writeField(fs, "use_gray", csrt.use_gray);
+	writeField(fs, "use_rgb", csrt.use_rgb);
+	writeField(fs, "use_channel_weights", csrt.use_channel_weights);
+	writeField(fs, "use_segmentation", csrt.use_segmentation);
+	writeField(fs, "window_function", csrt.window_function);
+	writeField(fs, "template_size", csrt.template_size);
+	writeField(fs, "padding", csrt.padding);
+	writeField(fs, "filter_lr", csrt.filter_lr);
+	writeField(fs, "num_hog_channels_used", csrt.num_hog_channels_used);
+	writeField(fs, "admm_iterations", csrt.admm_iterations);
+	writeField(fs, "histogram_bins", csrt.histogram_bins);
+	writeField(fs, "number_of_scales", csrt.number_of_scales);
+	writeField(fs, "scale_step", csrt.scale_step);
+	writeField(fs, "psr_threshold", csrt.psr_threshold);
+	fs << "}";
+
+	fs << "KCF" << "{";
+	writeField(fs, "detect_thresh", kcf.detect_thresh);
+	writeField(fs, "sigma", kcf.sigma);
+	writeField(fs, "interp_factor", kcf.interp_factor);
+	writeField(fs, "resize", kcf.resize);
+	writeField(fs, "compress_feature", kcf.compress_feature);
+	writeField(fs, "max_patch_size", kcf.max_patch_size);
+	writeField(fs, "compressed_size", kcf.compressed_size);
+	writeField(fs, "desc_pca", kcf.desc_pca);
+	writeField(fs, "desc_npca", kcf.desc_npca);
+	fs << "}";
+
+	fs << "MIL" << "{";
+	writeField(fs, "sampler_init_in_radius", mil.samplerInitInRadius);
+	writeField(fs, "sampler_init_max_neg_num", mil.samplerInitMaxNegNum);
+	writeField(fs, "sampler_search_win_size", mil.samplerSearchWinSize);
+	writeField(fs, "sampler_track_in_radius", mil.samplerTrackInRadius);
+	writeField(fs, "sampler_track_max_pos_num", mil.samplerTrackMaxPosNum);
+	writeField(fs, "sampler_track_max_neg_num", mil.samplerTrackMaxNegNum);
+	writeField(fs, "feature_set_num_features", mil.featureSetNumFeatures);
+	fs << "}";
+
+	fs << "GOTURN" << "{";
+	writeField(fs, "model_txt", goturn.modelTxt);
+	writeField(fs, "model_bin", goturn.modelBin);
+	fs << "}";
+
+	fs << "DaSiamRPN" << "{";
+	writeField(fs, "model", daSiamRPN.model);
+	writeField(fs, "kernel_cls1", daSiamRPN.kernel_cls1);
+	writeField(fs, "kernel_r1", daSiamRPN.kernel_r1);
+	writeField(fs, "backend", daSiamRPN.backend);
+	writeField(fs, "target", daSiamRPN.target);
+	fs << "}";
+
+	fs << "BOOSTING" << "{";
+	writeField(fs, "num_classifiers", boosting.numClassifiers);
+	writeField(fs, "sampler_overlap", boosting.samplerOverlap);
+	writeField(fs, "sampler_search_factor", boosting.samplerSearchFactor);
+	writeField(fs, "iteration_init", boosting.iterationInit);
+	writeField(fs, "feature_set_num_features", boosting.featureSetNumFeatures);
+	fs << "}";
+
+	fs << "MEDIANFLOW" << "{";
+	writeField(fs, "points_in_grid", medianFlow.pointsInGrid);
+	writeField(fs, "win_size", medianFlow.winSize);
+	writeField(fs, "max_level", medianFlow.maxLevel);
+	writeField(fs, "win_size_ncc", medianFlow.winSizeNCC);
+	writeField(fs, "max_median_displacement_difference", medianFlow.maxMedianLengthOfDisplacementDifference);
+	fs << "}";
+
+	fs << "BACKSUB" << "{";
+	writeField(fs, "history", backSub.history);
+	writeField(fs, "var_threshold", backSub.varThreshold);
+	writeField(fs, "learning_rate", backSub.learningRate);
+	writeField(fs, "scale", backSub.scale);
+	writeField(fs, "open_kernel", backSub.openKernel);
+	writeField(fs, "min_area", backSub.minArea);
+	fs << "}";
+
+	fs << "MEDIANBG" << "{";
+	writeField(fs, "threshold", medianBackground.threshold);
+	writeField(fs, "min_area", medianBackground.minArea);
+	fs << "}";
+}
+
+// FNV-1a of the written fields, the same for presets that track alike
+string TrackerPreset::fingerprint() const {
+	FileStorage fs(".yml", FileStorage::WRITE | FileStorage::MEMORY | FileStorage::FORMAT_YAML);
+	write(fs);
+	auto text = fs.releaseAndGetString();
+	uint64_t hash = 14695981039346656037ull;
+	for (auto c : text) {
+		hash = (hash ^ (unsigned char)c) * 1099511628211ull;
+	}
+	char hex[17];
+	snprintf(hex, sizeof(hex), "%016llx", (unsigned long long)hash);
+	return hex;
+}
+
+TrackerPresets::TrackerPresets() {
+	presets["fast"] = TrackerPreset::fast();
+	presets["balanced"] = TrackerPreset();
+	presets["accurate"] = TrackerPreset::accurate();
+}
+
+bool TrackerPresets::load(const string& path, string* error) {
+	FileStorage fs;
+	try {
+		fs.open(path, FileStorage::READ);
+	} catch (const Exception& e) {
+		if (error) {
+			*error = "Could not parse the presets " + path + ": " + e.what();
+		}
+		return false;
+	}
+	if (!fs.isOpened() || !fs["presets"].isMap()) {
+		if (error) {
+			*error = "Presets " + path + " have no presets map";
+		}
+		return false;
+	}
+	read(fs["presets"]);
+	return true;
+}
+
+void TrackerPresets::read(const FileNode& node) {
+	for (auto entry : node) {
+		auto name = entry.name();
+		if (presets.find(name) == presets.end()) {
+			presets[name] = TrackerPreset();
+		}
+		presets[name].read(entry);
+	}
+}
+
+bool TrackerPresets::find(const string& name, TrackerPreset& preset) const {
+	auto found = presets.find(name);
+	if (found == presets.end()) {
+		return false;
+	}
+	preset = found->second;
+	return true;
+}
+
+vector<string> TrackerPresets::names() const {
+	vector<string> result;
+	for (auto& [name, preset] : presets) {
+		result.push_back(name);
+	}
+	return result;
+}
@@ -0,0 +1,60 @@
+// trackerPresets.h : named speed / accuracy settings of every tracker type,
+// built in or loaded from a FileStorage config, so the trade-off is chosen per
+// run instead of at compile time.
+//
+
+#pragma once
+
+#include "backSubTracker.h"
+#include "medianBackground.h"
+
+#include <opencv2/core.hpp>
+#include <opencv2/tracking.hpp>
+#include <opencv2/tracking/tracking_legacy.hpp>
+
+#include <map>
+#include <string>
+#include <vector>
+
+// the parameters createTracker() builds each tracker type with, a default
+// constructed preset is "balanced"
+struct TrackerPreset {
+	cv::TrackerCSRT::Params csrt;
+	cv::TrackerKCF::Params kcf;
+	cv::TrackerMIL::Params mil;
+	cv::TrackerGOTURN::Params goturn;
+	cv::TrackerDaSiamRPN::Params daSiamRPN;
+	cv::legacy::TrackerBoosting::Params boosting;
+	cv::legacy::TrackerMedianFlow::Params medianFlow;
+	TrackerBackSub::Params backSub;
+	TrackerMedianBackground::Params medianBackground;
+	// TLD and MOSSE have nothing to tune
+
+	TrackerPreset();
+	static TrackerPreset fast();
+	static TrackerPreset accurate();
+
+	// overrides the fields present in a map of tracker type -> { field: value }
+	void read(const cv::FileNode& node);
+	// writes every field read() takes, in the same layout
+	void write(cv::FileStorage& fs) const;
+	// hex digest of every field, two presets with the same one track alike
+	std::string fingerprint() const;
+};
+
+class TrackerPresets {
+public:
+	// fast, balanced and accurate
+	TrackerPresets();
+
+	// reads the top level "presets" map of a FileStorage file, preset name ->
+	// tracker type -> fields, a new name starts from balanced
+	bool load(const std::string& path, std::string* error = nullptr);
+	void read(const cv::FileNode& node);
+
+	bool find(const std::string& name, TrackerPreset& preset) const;
+	std::vector<std::string> names() const;
+
+private:
+	std::map<std::string, TrackerPreset> presets;
+};
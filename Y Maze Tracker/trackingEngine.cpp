@@ -0,0 +1,492 @@
+// trackingEngine.cpp : Implements the tracking loop without any Win32 or
+// highgui dependency, so it also builds on Linux.
+//
+
+#include "trackingEngine.h"
+#include "frameDecoder.h"
+#include "backSubTracker.h"
+#include "medianBackground.h"
+#include "kalmanTracker.h"
+#include "zoneMap.h"
+#include "trajectoryFile.h"
+#include "resultWriter.h"
+#include "checkpoint.h"
+#include "stageTimers.h"
+#include "traceRecorder.h"
+#include "metricsServer.h"
+#include "allocCounter.h"
+#include "annotatedVideo.h"
+
+#include <opencv2/imgproc.hpp>
+#include <opencv2/videoio.hpp>
+#include <opencv2/video/background_segm.hpp>
+#include <opencv2/video/tracking.hpp>
+#include <opencv2/tracking/tracking_legacy.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+
+using namespace cv;
+using namespace std;
+
+const array<const char*, 11> trackerNames = {
+	"GOTURN", "CSRT", "KCF", "DaSiamRPN", "MIL", "BOOSTING", "TLD", "MEDIANFLOW", "MOSSE", "BACKSUB", "MEDIANBG",
+};
+
+Ptr<Tracker> createTracker(const string& type, const TrackerPreset& preset) {
+	if (type == "BOOSTING") {
+		return upgradeTrackingAPI(legacy::TrackerBoosting::create(preset.boosting));
+	} else if (type == "MIL") {
+		return TrackerMIL::create(preset.mil);
+	} else if (type == "KCF") {
+		return TrackerKCF::create(preset.kcf);
+	} else if (type == "TLD") {
+		return upgradeTrackingAPI(legacy::TrackerTLD::create());
+	} else if (type == "MEDIANFLOW") {
+		return upgradeTrackingAPI(legacy::TrackerMedianFlow::create(preset.medianFlow));
+	} else if (type == "MOSSE") {
+		return upgradeTrackingAPI(legacy::TrackerMOSSE::create());
+	} else if (type == "CSRT") {
+		return TrackerCSRT::create(preset.csrt);
+	} else if (type == "GOTURN") {
+		return TrackerGOTURN::create(preset.goturn);
+	} else if (type == "DaSiamRPN") {
+		return TrackerDaSiamRPN::create(preset.daSiamRPN);
+	} else if (type == "BACKSUB") {
+		return TrackerBackSub::create(preset.backSub);
+	}
+	return nullptr;
+}
+
+// the trackers of the current API can be initialized again, which keeps the
+// GOTURN and DaSiamRPN networks loaded, the legacy ones ignore a second init
+static bool canReinit(const string& type) {
+	return type == "GOTURN" || type == "CSRT" || type == "KCF" || type == "DaSiamRPN" || type == "MIL";
+}
+
+// puts the capture before the 0-based frame position. A backend that cannot
+// seek, or lands somewhere else, decodes forward from the start instead
+static bool seekFrame(VideoCapture& cap, const string& path, int position) {
+	if (cap.set(CAP_PROP_POS_FRAMES, position) && (int)cap.get(CAP_PROP_POS_FRAMES) == position) {
+		return true;
+	}
+	if (!cap.open(path)) {
+		return false;
+	}
+	for (auto i = 0; i < position; i++) {
+		if (!cap.grab()) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// review.avi -> review.from1801.avi, the file of a run that starts at firstFrame
+static string segmentPath(const string& path, int firstFrame) {
+	filesystem::path segment(path);
+	auto extension = segment.extension();
+	segment.replace_extension();
+	segment += ".from" + to_string(firstFrame);
+	segment += extension;
+	return segment.string();
+}
+
+// widest frame the background model learns on when only reacquisition uses it
+static const int reacquireWidth = 320;
+
+const char* zoneName(Zone zone) {
+	switch (zone) {
+	case ZONE_CENTER:
+		return "center";
+	case ZONE_A:
+		return "a";
+	case ZONE_B:
+		return "b";
+	case ZONE_C:
+		return "c";
+	default:
+		return "";
+	}
+}
+
+bool runTracking(const TrackingSession& session, TrackingResult& result, const FrameCallback& onFrame, string* error) {
+	auto fail = [error](const string& message) {
+		if (error) {
+			*error = message;
+		}
+		return false;
+	};
+
+	// a resumed run takes the maze and the mouse from the checkpoint
+	const bool resuming = session.resume && !session.checkpointPath.empty() && checkpointExists(session.checkpointPath);
+	Checkpoint resumed;
+	TrackingResult restored;
+	if (resuming) {
+		string checkpointError;
+		if (!loadCheckpoint(session.checkpointPath, resumed, restored, &checkpointError)) {
+			return fail(checkpointError);
+		}
+		// a trajectory tracked half with other settings would look like one run
+		auto differing = checkpointMismatch(resumed, session);
+		if (!differing.empty()) {
+			return fail("Checkpoint " + session.checkpointPath + " of " + resumed.videoPath + " was saved with a different " + differing);
+		}
+	}
+	const auto triangle = resuming ? resumed.triangle : session.triangle;
+	const auto selection = resuming ? resumed.selection : session.bbox;
+
+	// the background trackers are their own detectors and never need a re-init
+	const bool backgroundTracker = session.trackerType == "BACKSUB" || session.trackerType == "MEDIANBG";
+	Mat background;
+	if (session.trackerType == "MEDIANBG" && !buildMedianBackground(session.videoPath, session.backgroundSamples, background)) {
+		return fail("Could not build the median background of " + session.videoPath);
+	}
+	// a search window would hide the whole-frame view the background trackers rely on
+	const bool predictWindow = session.predictWindow && !backgroundTracker;
+	Ptr<TrackerKalmanWindow> kalman;
+	auto makeTracker = [&]() -> Ptr<Tracker> {
+		if (session.trackerType == "MEDIANBG") {
+			return TrackerMedianBackground::create(background, session.trackerParams.medianBackground);
+		}
+		auto type = session.trackerType;
+		auto& params = session.trackerParams;
+		if (!predictWindow || find(trackerNames.begin(), trackerNames.end(), type) == trackerNames.end()) {
+			return createTracker(type, params);
+		}
+		// a reacquisition initializes the window again, the inner tracker is
+		// kept for that when it allows a second init
+		kalman = TrackerKalmanWindow::create([type, params, inner = Ptr<Tracker>()]() mutable {
+			if (!inner || !canReinit(type)) {
+				inner = createTracker(type, params);
+			}
+			return inner;
+		});
+		return kalman;
+	};
+	auto tracker = makeTracker();
+	if (!tracker) {
+		return fail("Unknown tracker type " + session.trackerType);
+	}
+	const bool reacquire = session.reacquire && !backgroundTracker;
+	const bool reinitInPlace = canReinit(session.trackerType) || kalman != nullptr;
+	Ptr<BackgroundSubtractor> pBackSub;
+	if ((session.useBackSub || reacquire) && !backgroundTracker) {
+		//create Background Subtractor objects
+		pBackSub = createBackgroundSubtractorMOG2();
+	}
+	Mat blobMask, detectFrame;
+	const auto blobKernel = getStructuringElement(MORPH_ELLIPSE, Size(5, 5));
+	bool reacquired = resuming && resumed.reacquired;
+
+	auto cap = VideoCapture(session.videoPath);
+	if (!cap.isOpened()) {
+		return fail("Could not open the input video " + session.videoPath);
+	}
+	// frame numbers are 1-based, the capture position 0-based
+	if (resuming && !seekFrame(cap, session.videoPath, resumed.frame - 1)) {
+		return fail("Could not seek " + session.videoPath + " to frame " + to_string(resumed.frame));
+	}
+	// read before the decoder thread starts using the capture
+	const auto fps = cap.get(CAP_PROP_FPS);
+	const auto frameCount = cap.get(CAP_PROP_FRAME_COUNT);
+	auto trace = session.trace.get();
+	if (trace) {
+		trace->nameThread("tracking " + session.videoPath);
+	}
+	FrameDecoder decoder(cap, max(session.decodeQueue, 0), trace);
+	auto slot = decoder.next();
+	if (!slot) {
+		return fail("Could not read the first frame of " + session.videoPath);
+	}
+	// the checkpointed frame is the last one in the trajectory, a seek that
+	// reports the right position but decodes another frame shows in the time
+	if (resuming && fps > 0 && abs(slot->timestamp - restored.trajectory.timestamp.back()) > 500 / fps) {
+		return fail("Seeking " + session.videoPath + " to frame " + to_string(resumed.frame) + " landed at " +
+			to_string((int)slot->timestamp) + " ms instead of " + to_string((int)restored.trajectory.timestamp.back()) + " ms");
+	}
+	Mat fgMask;
+	// a model that only serves the reacquisition learns on a reduced copy, the
+	// blob has to be found, not outlined
+	const double detectScale = session.useBackSub ? 1 : min(1.0, reacquireWidth / (double)slot->image.cols);
+	// a blob much smaller than the selected mouse is noise
+	const int minBlobArea = max(1, (int)(max(30, selection.area() / 10) * detectScale * detectScale));
+
+	// fail before the run rather than after it if the output cannot be written
+	for (auto& path : { session.trajectoryPath, session.trajectoryBinPath }) {
+		if (!path.empty() && !ofstream(path)) {
+			return fail("Could not open " + path + " for writing");
+		}
+	}
+	// a run that does not resume starts its checkpoint over, the rows file
+	// sits next to the yaml and tells whether the folder is writable
+	unique_ptr<CheckpointWriter> checkpoints;
+	if (!session.checkpointPath.empty()) {
+		if (!resuming) {
+			removeCheckpoint(session.checkpointPath);
+		}
+		checkpoints = make_unique<CheckpointWriter>(session.checkpointPath, resuming ? restored.trajectory.size() : 0);
+		if (!checkpoints->isOpen()) {
+			return fail("Could not open " + session.checkpointPath + " for writing");
+		}
+	}
+
+	// streamed while tracking, so a run that dies still leaves its results behind
+	unique_ptr<ResultWriter> results;
+	if (!session.resultsPath.empty()) {
+		auto sink = createSink(session.resultsFormat);
+		if (!sink) {
+			return fail("Unknown results format " + session.resultsFormat);
+		}
+		results = make_unique<ResultWriter>(session.resultsPath, move(sink));
+		if (!results->isOpen()) {
+			return fail("Could not open " + session.resultsPath + " for writing");
+		}
+		// the file starts over, the rows of the earlier runs go in first
+		auto& t = restored.trajectory;
+		const Mat noImage;
+		for (size_t i = 0; resuming && i < t.size(); i++) {
+			FrameInfo info{ t.frame[i], t.timestamp[i], noImage, Rect(t.x[i], t.y[i], t.width[i], t.height[i]),
+				t.success[i] != 0, (Zone)t.zone[i], restored };
+			results->write(info);
+		}
+	}
+
+	// drawn and encoded on its own thread, the loop only copies the frame
+	unique_ptr<AnnotatedVideoWriter> annotated;
+	if (!session.annotatedPath.empty()) {
+		// the video of the earlier runs is kept, the resumed frames go to a segment next to it
+		const auto annotatedPath = resuming ? segmentPath(session.annotatedPath, resumed.frame + 1) : session.annotatedPath;
+		annotated = make_unique<AnnotatedVideoWriter>(annotatedPath, fps, slot->image.size(),
+			session.trackerType);
+		if (!annotated->isOpen()) {
+			return fail("Could not open " + annotatedPath + " for writing");
+		}
+	}
+
+	// zones are rasterized once, every frame is a single lookup
+	const ZoneMap zones(slot->image.size(), triangle);
+
+	result = resuming ? move(restored) : TrackingResult();
+	if (frameCount > 0) {
+		// the count is an estimate for some containers, the slack keeps the
+		// last frames from growing every column
+		result.trajectory.reserve((size_t)frameCount + 256);
+	}
+	BehaviorMetrics::Params behaviorParams;
+	behaviorParams.debounceFrames = session.entryDebounce;
+	BehaviorMetrics behavior(behaviorParams);
+	// the metrics are a function of the trajectory, replaying it restores them
+	for (size_t i = 0; i < result.trajectory.size(); i++) {
+		auto& t = result.trajectory;
+		behavior.update(Rect(t.x[i], t.y[i], t.width[i], t.height[i]), t.timestamp[i], t.success[i] != 0, t.zone[i]);
+	}
+	const auto previousSeconds = result.seconds;
+	auto start = getTickCount();
+	auto bbox = resuming ? resumed.bbox : selection;
+	// Initialize tracker with first frame and bounding box
+	tracker->init(slot->image, bbox);
+	auto frame = 1;
+	if (resuming) {
+		// the checkpointed frame is already in the trajectory, it only initializes the tracker
+		frame = resumed.frame + 1;
+		slot = decoder.next();
+	}
+
+	const auto presetFingerprint = checkpoints ? session.trackerParams.fingerprint() : string();
+	auto saveSnapshot = [&](int lastFrame) {
+		Checkpoint state;
+		state.videoPath = session.videoPath;
+		state.trackerType = session.trackerType;
+		state.preset = presetFingerprint;
+		state.useBackSub = session.useBackSub;
+		state.reacquire = session.reacquire;
+		state.predictWindow = session.predictWindow;
+		state.triangle = triangle;
+		state.selection = selection;
+		state.frame = lastFrame;
+		state.bbox = bbox;
+		state.reacquired = reacquired;
+		state.seconds = previousSeconds + (getTickCount() - start) / getTickFrequency();
+		state.coastedFrames = result.coastedFrames + (kalman ? kalman->coastedFrames() : 0);
+		return checkpoints->save(state, result);
+	};
+	// the live counters are shared with the server thread, they are copied out
+	// every few frames rather than written by every stage
+	auto live = session.metrics.get();
+	const int publishInterval = 16;
+	auto publishedFrame = frame - 1;
+	auto publishedTick = getTickCount();
+	auto publish = [&] {
+		auto now = getTickCount();
+		if (now > publishedTick) {
+			live->fps.store((result.frames - publishedFrame) * getTickFrequency() / (now - publishedTick), memory_order_relaxed);
+		}
+		publishedFrame = result.frames;
+		publishedTick = now;
+		live->frames.store(result.frames, memory_order_relaxed);
+		live->failures.store(result.failures, memory_order_relaxed);
+		live->reacquisitions.store(result.reacquisitions, memory_order_relaxed);
+		live->decodeQueue.store((int64_t)decoder.queued(), memory_order_relaxed);
+		for (auto i = 0; i < STAGE_COUNT; i++) {
+			auto& h = result.timings[(Stage)i];
+			live->stageCalls[i].store(h.count(), memory_order_relaxed);
+			live->stageSeconds[i].store(h.totalMs() / 1000, memory_order_relaxed);
+		}
+	};
+	if (live) {
+		live->running = true;
+	}
+	const auto checkpointInterval = max(session.checkpointInterval, 1);
+	bool stopped = false;
+	auto timings = &result.timings;
+	timings->traceTo(trace);
+	auto nextFrame = [&] {
+		// frame is already incremented, the wait belongs to the next frame
+		timings->traceFrame(frame);
+		ScopedStage timer(timings, STAGE_DECODE);
+		return decoder.next();
+	};
+
+	for (; slot; frame++, slot = nextFrame()) {
+		const auto frameStart = trace ? getTickCount() : 0;
+		timings->traceFrame(frame);
+		const auto& src = slot->image;
+		if (pBackSub) {
+			ScopedStage timer(timings, STAGE_BACKSUB);
+			//update the background model
+			if (detectScale < 1) {
+				resize(src, detectFrame, Size(), detectScale, detectScale, INTER_AREA);
+				pBackSub->apply(detectFrame, fgMask);
+			} else {
+				pBackSub->apply(src, fgMask);
+			}
+		}
+
+		auto zone = ZONE_NONE;
+		bool success;
+		{
+			ScopedStage timer(timings, STAGE_UPDATE);
+			// Update tracker
+			success = tracker->update(src, bbox);
+		}
+		if (!success) {
+			result.failures += 1;
+			reacquired = false;
+			if (reacquire) {
+				ScopedStage timer(timings, STAGE_REACQUIRE);
+				Rect blob;
+				Point2f centroid;
+				// shadows are 127 in the MOG2 mask
+				threshold(fgMask, blobMask, 200, 255, THRESH_BINARY);
+				morphologyEx(blobMask, blobMask, MORPH_OPEN, blobKernel);
+				if (findLargestBlob(blobMask, blob, centroid, minBlobArea)) {
+					// keep the size the mouse was selected with, centered on the blob
+					bbox = Rect((int)(centroid.x / detectScale) - selection.width / 2, (int)(centroid.y / detectScale) - selection.height / 2,
+						selection.width, selection.height);
+					// a mouse found at the edge would put the box partly outside, which
+					// several trackers throw on, so it is moved inside the frame
+					bbox.x = max(0, min(bbox.x, src.cols - bbox.width));
+					bbox.y = max(0, min(bbox.y, src.rows - bbox.height));
+					bbox &= Rect(Point(), src.size());
+					if (!reinitInPlace) {
+						tracker = makeTracker();
+					}
+					tracker->init(src, bbox);
+					result.reacquisitions += 1;
+					reacquired = success = true;
+				}
+			}
+		} else if (reacquired) {
+			result.recoveredFrames += 1;
+		}
+
+		// the engine's own per-frame work should not touch the heap, the
+		// trackers and MOG2 are outside of this count
+		const auto allocationsBefore = threadAllocations();
+		ScopedStage classifyTimer(timings, STAGE_CLASSIFY);
+		if (success) {
+			auto mouse_center = Point(bbox.x + bbox.width / 2, bbox.y + bbox.height / 2);
+			zone = zones.classify(mouse_center);
+			switch (zone) {
+			case ZONE_CENTER:
+				result.in_center += 1;
+				break;
+			case ZONE_A:
+				result.a += 1;
+				break;
+			case ZONE_B:
+				result.b += 1;
+				break;
+			case ZONE_C:
+				result.c += 1;
+				break;
+			default:
+				break;
+			}
+		}
+		result.frames = frame;
+		behavior.update(bbox, slot->timestamp, success, zone);
+		classifyTimer.stop();
+
+		ScopedStage outputTimer(timings, STAGE_OUTPUT);
+		result.trajectory.append(frame, slot->timestamp, bbox, success, zone);
+		if (onFrame || results || annotated) {
+			FrameInfo info{ frame, slot->timestamp, src, bbox, success, zone, result };
+			if (results) {
+				results->write(info);
+			}
+			if (annotated) {
+				annotated->write(info);
+			}
+			stopped = onFrame && !onFrame(info);
+		}
+		result.loopAllocations += threadAllocations() - allocationsBefore;
+		// a failed save keeps the previous checkpoint, which is still consistent
+		if (!session.checkpointPath.empty() && (stopped || frame % checkpointInterval == 0)) {
+			saveSnapshot(frame);
+		}
+		outputTimer.stop();
+		if (live && frame % publishInterval == 0) {
+			publish();
+		}
+		if (trace) {
+			trace->span("frame", frameStart, getTickCount(), frame);
+		}
+		if (stopped) {
+			break;
+		}
+	}
+	// the result outlives the recorder
+	timings->traceTo(nullptr);
+	if (live) {
+		publish();
+		live->running = false;
+	}
+	if (kalman) {
+		result.coastedFrames += kalman->coastedFrames();
+	}
+	result.seconds = previousSeconds + (getTickCount() - start) / getTickFrequency();
+	result.behavior = behavior.report();
+	if (annotated) {
+		annotated->close();
+	}
+	if (results) {
+		results->close();
+		if (!results->good()) {
+			return fail("Could not write " + session.resultsPath);
+		}
+	}
+	if (!session.trajectoryPath.empty() && !result.trajectory.writeCsv(session.trajectoryPath)) {
+		return fail("Could not write " + session.trajectoryPath);
+	}
+	if (!session.trajectoryBinPath.empty() && !writeTrajectoryFile(session.trajectoryBinPath, result.trajectory, triangle, session.trackerType)) {
+		return fail("Could not write " + session.trajectoryBinPath);
+	}
+	if (!stopped && checkpoints) {
+		checkpoints.reset();
+		removeCheckpoint(session.checkpointPath);
+	}
+	return true;
+}
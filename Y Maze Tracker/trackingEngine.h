@@ -0,0 +1,96 @@
+// trackingEngine.h : portable, display-free tracking engine shared by the
+// Win32 front end and the command line batch tool.
+//
+
+#pragma once
+
+#include "trajectory.h"
+#include "behaviorMetrics.h"
+#include "trackerPresets.h"
+#include "stageTimers.h"
+
+#include <opencv2/core.hpp>
+#include <opencv2/tracking.hpp>
+
+#include <array>
+#include <functional>
+#include <memory>
+#include <string>
+
+class TraceRecorder;
+struct LiveMetrics;
+
+// zone the mouse center falls in
+enum Zone : unsigned char {
+	ZONE_NONE = 0,		// tracking failed, no zone
+	ZONE_CENTER,
+	ZONE_A,
+	ZONE_B,
+	ZONE_C,
+};
+
+// tracker type names accepted by createTracker()
+extern const std::array<const char*, 11> trackerNames;
+
+// everything needed to track one video without any user interaction
+struct TrackingSession {
+	std::string videoPath;					// input video
+	std::array<cv::Point, 3> triangle;		// vertices of the center of the maze
+	cv::Rect bbox;							// mouse on the first frame
+	std::string trackerType = "CSRT";		// one of trackerNames
+	TrackerPreset trackerParams;			// parameters of the tracker, see TrackerPresets
+	bool useBackSub = false;				// update a MOG2 background model every frame
+	int decodeQueue = 8;					// frames decoded ahead on a separate thread, 0 decodes inline
+	std::string trajectoryPath;				// csv written from the trajectory at the end, empty for none
+	std::string trajectoryBinPath;			// binary trajectory file (trajectoryFile.h), empty for none
+	int backgroundSamples = 25;				// frames sampled for the MEDIANBG background
+	bool reacquire = false;					// re-init the tracker on the largest foreground blob after a failure
+	bool predictWindow = false;				// track inside a Kalman predicted window, coasting through dropouts
+	std::string resultsPath;				// per-frame results streamed during the run, "-" for stdout, empty for none
+	std::string resultsFormat = "csv";		// csv or ndjson
+	std::string truthPath;					// labeled trajectory the clip is scored against by ymaze_eval, unused by the engine
+	int entryDebounce = 5;					// frames the mouse must stay in an arm before the entry counts
+	std::string checkpointPath;				// periodic snapshot of the run (checkpoint.h), empty for none
+	int checkpointInterval = 1800;			// frames between checkpoints
+	bool resume = false;					// continue from checkpointPath if it exists, triangle and bbox are ignored then
+	std::shared_ptr<TraceRecorder> trace;	// spans of every stage and frame (traceRecorder.h), may be shared by sessions
+	std::shared_ptr<LiveMetrics> metrics;	// counters published for a MetricsServer (metricsServer.h), none if null
+	std::string annotatedPath;				// annotated copy of the video encoded during the run (annotatedVideo.h), empty for none
+};
+
+struct TrackingResult {
+	int in_center = 0, a = 0, b = 0, c = 0;	// number of frames spent in each zone
+	int frames = 0;							// frames processed
+	int failures = 0;						// frames where tracker->update failed
+	int reacquisitions = 0;					// times the tracker was re-initialized on a foreground blob
+	int recoveredFrames = 0;				// frames tracked by a re-initialized tracker
+	int coastedFrames = 0;					// frames bridged by the Kalman prediction
+	double seconds = 0;						// wall time of the tracking loop, summed over resumed runs
+	Trajectory trajectory;					// every processed frame
+	BehaviorReport behavior;				// arm entries, alternation, distance and speed
+	StageTimers timings;					// latency of each stage of the loop in this run
+	int64_t loopAllocations = 0;			// heap allocations of the classify and output stages, checkpoints aside
+};
+
+// state of a single processed frame, handed to the per-frame callback
+struct FrameInfo {
+	int frame;								// 1-based frame number
+	double timestamp;						// position in the video in ms
+	const cv::Mat& image;					// decoded frame, only valid during the callback
+	cv::Rect bbox;
+	bool success;							// tracker->update result
+	Zone zone;
+	const TrackingResult& result;			// counters so far
+};
+
+// return false to stop tracking early
+using FrameCallback = std::function<bool(const FrameInfo&)>;
+
+// MEDIANBG needs the video to build its background and is created by runTracking
+cv::Ptr<cv::Tracker> createTracker(const std::string& type, const TrackerPreset& preset = TrackerPreset());
+const char* zoneName(Zone zone);
+
+// runs the tracking loop over the whole video, returns false and fills error
+// if the session could not be started
+bool runTracking(const TrackingSession& session, TrackingResult& result,
+	const FrameCallback& onFrame = nullptr, std::string* error = nullptr);
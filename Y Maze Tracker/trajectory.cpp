@@ -0,0 +1,82 @@
+// trajectory.cpp : Growth and csv export of the column store.
+//
+
+#include "trajectory.h"
+#include "trackingEngine.h"
+
+#include <cstdio>
+#include <cstring>
+
+using namespace cv;
+using namespace std;
+
+void Trajectory::reserve(size_t frames) {
+	frame.reserve(frames);
+	timestamp.reserve(frames);
+	x.reserve(frames);
+	y.reserve(frames);
+	width.reserve(frames);
+	height.reserve(frames);
+	success.reserve(frames);
+	zone.reserve(frames);
+}
+
+void Trajectory::resize(size_t rows) {
+	frame.resize(rows);
+	timestamp.resize(rows);
+	x.resize(rows);
+	y.resize(rows);
+	width.resize(rows);
+	height.resize(rows);
+	success.resize(rows);
+	zone.resize(rows);
+}
+
+void Trajectory::clear() {
+	// assign empty columns so the memory is returned, not just the size
+	*this = Trajectory();
+}
+
+bool Trajectory::writeCsv(const string& path) const {
+	auto file = fopen(path.c_str(), "w");
+	if (!file) {
+		return false;
+	}
+	fputs("frame,timestamp_ms,x,y,width,height,success,zone\n", file);
+	for (size_t i = 0; i < size(); i++) {
+		fprintf(file, "%d,%.3f,%d,%d,%d,%d,%d,%s\n", frame[i], timestamp[i], x[i], y[i], width[i], height[i],
+			success[i], zoneName((Zone)zone[i]));
+	}
+	return fclose(file) == 0;
+}
+
+bool Trajectory::readCsv(const string& path) {
+	auto file = fopen(path.c_str(), "r");
+	if (!file) {
+		return false;
+	}
+	clear();
+	char line[256];
+	auto ok = fgets(line, sizeof(line), file) != nullptr;	// header
+	while (ok && fgets(line, sizeof(line), file)) {
+		int frameNumber, tracked;
+		double time;
+		Rect bbox;
+		char zoneText[16] = {};
+		auto fields = sscanf(line, "%d,%lf,%d,%d,%d,%d,%d,%15[a-z]", &frameNumber, &time, &bbox.x, &bbox.y,
+			&bbox.width, &bbox.height, &tracked, zoneText);
+		if (fields < 7) {
+			ok = false;
+			break;
+		}
+		auto zoneLabel = ZONE_NONE;
+		for (auto z : { ZONE_CENTER, ZONE_A, ZONE_B, ZONE_C }) {
+			if (strcmp(zoneText, zoneName(z)) == 0) {
+				zoneLabel = z;
+			}
+		}
+		append(frameNumber, time, bbox, tracked != 0, zoneLabel);
+	}
+	fclose(file);
+	return ok;
+}
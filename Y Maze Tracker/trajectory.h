@@ -0,0 +1,40 @@
+// trajectory.h : per-frame tracking output kept as contiguous columns, so
+// downstream metrics are plain scans instead of another tracking run.
+//
+
+#pragma once
+
+#include <opencv2/core.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct Trajectory {
+	std::vector<int32_t> frame;				// 1-based frame number
+	std::vector<double> timestamp;			// position in the video in ms
+	std::vector<int32_t> x, y, width, height;	// bounding box
+	std::vector<uint8_t> success;			// tracker->update result
+	std::vector<uint8_t> zone;				// Zone of the box center
+
+	size_t size() const { return frame.size(); }
+	bool empty() const { return frame.empty(); }
+	void reserve(size_t frames);
+	// keeps the first rows, or pads with empty rows
+	void resize(size_t rows);
+	void clear();
+	void append(int frameNumber, double time, const cv::Rect& bbox, bool ok, uint8_t zoneLabel) {
+		frame.push_back(frameNumber);
+		timestamp.push_back(time);
+		x.push_back(bbox.x);
+		y.push_back(bbox.y);
+		width.push_back(bbox.width);
+		height.push_back(bbox.height);
+		success.push_back(ok);
+		zone.push_back(zoneLabel);
+	}
+
+	bool writeCsv(const std::string& path) const;
+	// reads the format writeCsv writes, false on a missing file or a malformed row
+	bool readCsv(const std::string& path);
+};
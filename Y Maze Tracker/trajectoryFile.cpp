@@ -0,0 +1,237 @@
+// trajectoryFile.cpp : Writer and memory mapped reader of the binary
+// trajectory format.
+//
+
+#include "trajectoryFile.h"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace cv;
+using namespace std;
+
+static const char trajectoryMagic[8] = { 'Y', 'M', 'Z', 'T', 'R', 'A', 'J', 0 };
+static const size_t columnWidth[COL_COUNT] = { 4, 8, 4, 4, 4, 4, 4, 4, 1, 1 };
+
+static uint64_t align8(uint64_t offset) {
+	return (offset + 7) & ~(uint64_t)7;
+}
+
+// count items of width bytes at offset end within length, without overflowing
+static bool fits(uint64_t offset, uint64_t count, uint64_t width, uint64_t length) {
+	return offset % 8 == 0 && offset <= length && count <= (length - offset) / width;
+}
+
+bool writeTrajectoryFile(const string& path, const Trajectory& trajectory, const array<Point, 3>& triangle, const string& trackerType) {
+	TrajectoryFileHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, trajectoryMagic, sizeof(header.magic));
+	header.version = TRAJECTORY_FILE_VERSION;
+	header.headerSize = sizeof(header);
+	header.rows = trajectory.size();
+	for (auto i = 0; i < 3; i++) {
+		header.triangle[i * 2] = triangle[i].x;
+		header.triangle[i * 2 + 1] = triangle[i].y;
+	}
+	strncpy(header.trackerType, trackerType.c_str(), sizeof(header.trackerType) - 1);
+
+	// frame index over the covered range, later rows win if a frame repeats
+	vector<int32_t> index;
+	if (!trajectory.empty()) {
+		header.firstFrame = header.lastFrame = trajectory.frame[0];
+		for (auto f : trajectory.frame) {
+			header.firstFrame = min(header.firstFrame, f);
+			header.lastFrame = max(header.lastFrame, f);
+		}
+		index.assign((size_t)header.lastFrame - header.firstFrame + 1, -1);
+		for (size_t row = 0; row < trajectory.size(); row++) {
+			index[trajectory.frame[row] - header.firstFrame] = (int32_t)row;
+		}
+	}
+	header.indexCount = index.size();
+
+	uint64_t offset = align8(sizeof(header));
+	for (auto c = 0; c < COL_COUNT; c++) {
+		header.columnOffset[c] = offset;
+		offset = align8(offset + columnWidth[c] * header.rows);
+	}
+	header.indexOffset = offset;
+
+	vector<float> centerX(trajectory.size()), centerY(trajectory.size());
+	for (size_t i = 0; i < trajectory.size(); i++) {
+		centerX[i] = trajectory.x[i] + trajectory.width[i] / 2.f;
+		centerY[i] = trajectory.y[i] + trajectory.height[i] / 2.f;
+	}
+	const void* columns[COL_COUNT] = {
+		trajectory.frame.data(), trajectory.timestamp.data(), centerX.data(), centerY.data(),
+		trajectory.x.data(), trajectory.y.data(), trajectory.width.data(), trajectory.height.data(),
+		trajectory.success.data(), trajectory.zone.data(),
+	};
+
+	auto file = fopen(path.c_str(), "wb");
+	if (!file) {
+		return false;
+	}
+	static const char padding[8] = {};
+	auto ok = fwrite(&header, sizeof(header), 1, file) == 1;
+	uint64_t written = sizeof(header);
+	for (auto c = 0; c < COL_COUNT && ok; c++) {
+		ok = fwrite(padding, 1, header.columnOffset[c] - written, file) == header.columnOffset[c] - written;
+		written = header.columnOffset[c];
+		auto bytes = columnWidth[c] * header.rows;
+		ok = ok && fwrite(columns[c], 1, bytes, file) == bytes;
+		written += bytes;
+	}
+	ok = ok && fwrite(padding, 1, header.indexOffset - written, file) == header.indexOffset - written;
+	ok = ok && fwrite(index.data(), sizeof(int32_t), index.size(), file) == index.size();
+	return fclose(file) == 0 && ok;
+}
+
+TrajectoryFile::~TrajectoryFile() {
+	close();
+}
+
+bool TrajectoryFile::open(const string& path, string* error) {
+	auto fail = [this, error](const string& message) {
+		close();
+		if (error) {
+			*error = message;
+		}
+		return false;
+	};
+
+	close();
+#ifdef _WIN32
+	auto handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (handle == INVALID_HANDLE_VALUE) {
+		return fail("Could not open " + path);
+	}
+	file = handle;
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(handle, &size) || size.QuadPart == 0) {
+		return fail(path + " is empty");
+	}
+	length = (size_t)size.QuadPart;
+	mapping = CreateFileMappingA(handle, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (!mapping) {
+		return fail("Could not map " + path);
+	}
+	data = (const unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (!data) {
+		return fail("Could not map " + path);
+	}
+#else
+	auto fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		return fail("Could not open " + path);
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0) {
+		::close(fd);
+		return fail(path + " is empty");
+	}
+	length = (size_t)st.st_size;
+	auto mapped = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+	// the mapping keeps the file alive
+	::close(fd);
+	if (mapped == MAP_FAILED) {
+		return fail("Could not map " + path);
+	}
+	data = (const unsigned char*)mapped;
+#endif
+
+	if (length < sizeof(TrajectoryFileHeader) || memcmp(header().magic, trajectoryMagic, sizeof(trajectoryMagic)) != 0) {
+		return fail(path + " is not a trajectory file");
+	}
+	if (header().version != TRAJECTORY_FILE_VERSION || header().headerSize != sizeof(TrajectoryFileHeader)) {
+		return fail(path + " has unsupported version " + to_string(header().version));
+	}
+	auto& h = header();
+	for (auto c = 0; c < COL_COUNT; c++) {
+		if (!fits(h.columnOffset[c], h.rows, columnWidth[c], length)) {
+			return fail(path + " is truncated");
+		}
+	}
+	if (!fits(h.indexOffset, h.indexCount, sizeof(int32_t), length)) {
+		return fail(path + " is truncated");
+	}
+	// rowOf() trusts the index, so it has to cover exactly the frame range and
+	// point at rows that exist
+	auto expected = h.rows == 0 ? 0 : h.lastFrame < h.firstFrame ? -1 : (int64_t)h.lastFrame - h.firstFrame + 1;
+	if ((int64_t)h.indexCount != expected) {
+		return fail(path + " has a frame index that does not match its frame range");
+	}
+	auto index = (const int32_t*)(data + h.indexOffset);
+	for (uint64_t i = 0; i < h.indexCount; i++) {
+		if (index[i] < -1 || (uint64_t)index[i] + 1 > h.rows) {
+			return fail(path + " has a frame index entry past the last row");
+		}
+	}
+	return true;
+}
+
+void TrajectoryFile::close() {
+#ifdef _WIN32
+	if (data) {
+		UnmapViewOfFile(data);
+	}
+	if (mapping) {
+		CloseHandle(mapping);
+	}
+	if (file) {
+		CloseHandle(file);
+	}
+	file = mapping = nullptr;
+#else
+	if (data) {
+		munmap((void*)data, length);
+	}
+#endif
+	data = nullptr;
+	length = 0;
+}
+
+string TrajectoryFile::trackerType() const {
+	auto& type = header().trackerType;
+	return string(type, strnlen(type, sizeof(type)));
+}
+
+array<Point, 3> TrajectoryFile::triangle() const {
+	array<Point, 3> triangle;
+	for (auto i = 0; i < 3; i++) {
+		triangle[i] = Point(header().triangle[i * 2], header().triangle[i * 2 + 1]);
+	}
+	return triangle;
+}
+
+int64_t TrajectoryFile::rowOf(int frame) const {
+	auto& h = header();
+	if (h.indexCount == 0 || frame < h.firstFrame || frame > h.lastFrame) {
+		return -1;
+	}
+	return ((const int32_t*)(data + h.indexOffset))[frame - h.firstFrame];
+}
+
+void TrajectoryFile::read(Trajectory& trajectory) const {
+	auto n = rows();
+	trajectory.frame.assign(frames(), frames() + n);
+	trajectory.timestamp.assign(timestamps(), timestamps() + n);
+	trajectory.x.assign(x(), x() + n);
+	trajectory.y.assign(y(), y() + n);
+	trajectory.width.assign(width(), width() + n);
+	trajectory.height.assign(height(), height() + n);
+	trajectory.success.assign(success(), success() + n);
+	trajectory.zone.assign(zones(), zones() + n);
+}
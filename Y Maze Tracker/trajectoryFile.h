@@ -0,0 +1,94 @@
+// trajectoryFile.h : versioned binary trajectory file with fixed-width
+// columns and a frame index, read through a memory mapping without parsing.
+//
+
+#pragma once
+
+#include "trajectory.h"
+
+#include <opencv2/core.hpp>
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+enum TrajectoryColumn {
+	COL_FRAME,			// int32
+	COL_TIMESTAMP,		// double, ms
+	COL_CENTER_X,		// float, box center
+	COL_CENTER_Y,		// float
+	COL_X,				// int32, box
+	COL_Y,				// int32
+	COL_WIDTH,			// int32
+	COL_HEIGHT,			// int32
+	COL_SUCCESS,		// uint8
+	COL_ZONE,			// uint8, Zone
+	COL_COUNT
+};
+
+const uint32_t TRAJECTORY_FILE_VERSION = 1;
+
+// all offsets are in bytes from the start of the file, every column and the
+// index start 8 byte aligned
+struct TrajectoryFileHeader {
+	char magic[8];						// "YMZTRAJ"
+	uint32_t version;
+	uint32_t headerSize;				// sizeof(TrajectoryFileHeader)
+	uint64_t rows;
+	int32_t firstFrame, lastFrame;		// range covered by the index
+	int32_t triangle[6];				// maze center, x1, y1, x2, y2, x3, y3
+	char trackerType[16];				// zero padded
+	uint64_t columnOffset[COL_COUNT];
+	uint64_t indexOffset;				// int32 row per frame in [firstFrame, lastFrame], -1 if missing
+	uint64_t indexCount;
+};
+static_assert(sizeof(TrajectoryFileHeader) == 168, "trajectory file header layout changed");
+
+bool writeTrajectoryFile(const std::string& path, const Trajectory& trajectory,
+	const std::array<cv::Point, 3>& triangle, const std::string& trackerType);
+
+// read-only memory mapping of a trajectory file
+class TrajectoryFile {
+public:
+	TrajectoryFile() {}
+	~TrajectoryFile();
+	TrajectoryFile(const TrajectoryFile&) = delete;
+	TrajectoryFile& operator=(const TrajectoryFile&) = delete;
+
+	// maps the file and checks the header, error says why on failure
+	bool open(const std::string& path, std::string* error = nullptr);
+	void close();
+
+	const TrajectoryFileHeader& header() const { return *(const TrajectoryFileHeader*)data; }
+	size_t rows() const { return (size_t)header().rows; }
+	std::string trackerType() const;
+	std::array<cv::Point, 3> triangle() const;
+
+	const int32_t* frames() const { return column<int32_t>(COL_FRAME); }
+	const double* timestamps() const { return column<double>(COL_TIMESTAMP); }
+	const float* centerX() const { return column<float>(COL_CENTER_X); }
+	const float* centerY() const { return column<float>(COL_CENTER_Y); }
+	const int32_t* x() const { return column<int32_t>(COL_X); }
+	const int32_t* y() const { return column<int32_t>(COL_Y); }
+	const int32_t* width() const { return column<int32_t>(COL_WIDTH); }
+	const int32_t* height() const { return column<int32_t>(COL_HEIGHT); }
+	const uint8_t* success() const { return column<uint8_t>(COL_SUCCESS); }
+	const uint8_t* zones() const { return column<uint8_t>(COL_ZONE); }
+
+	// row of a frame number, -1 if the frame is not in the file
+	int64_t rowOf(int frame) const;
+	// copies the columns back into a trajectory
+	void read(Trajectory& trajectory) const;
+
+private:
+	template <class T> const T* column(TrajectoryColumn c) const {
+		return (const T*)(data + header().columnOffset[c]);
+	}
+
+	const unsigned char* data = nullptr;
+	size_t length = 0;
+#ifdef _WIN32
+	void* file = nullptr;
+	void* mapping = nullptr;
+#endif
+};
@@ -0,0 +1,63 @@
+// zoneMap.cpp : Rasterizes the center triangle and the three arm wedges.
+//
+
+#include "zoneMap.h"
+
+#include <opencv2/imgproc.hpp>
+
+#include <algorithm>
+
+using namespace cv;
+using namespace std;
+
+ZoneMap::ZoneMap(Size size, const array<Point, 3>& triangle) {
+	labelImage.create(size, CV_8UC1);
+	labelImage.setTo(Scalar(ZONE_NONE));
+
+	auto center = Point2f((triangle[0].x + triangle[1].x + triangle[2].x) / 3.f, (triangle[0].y + triangle[1].y + triangle[2].y) / 3.f);
+	// far enough to leave the image, small enough for fillConvexPoly's fixed point
+	auto reach = 2.f * (size.width + size.height);
+	auto farPoint = [&](Point vertex) {
+		auto direction = Point2f(vertex) - center;
+		auto length = max(1.f, (float)norm(direction));
+		return Point(center + direction * (reach / length));
+	};
+
+	// arm i lies between the rays through vertex i and vertex i + 1
+	array<Point2f, 3> directions;
+	for (auto i = 0; i < 3; i++) {
+		auto& v1 = triangle[i];
+		auto& v2 = triangle[(i + 1) % 3];
+		directions[i] = Point2f((v1.x + v2.x) / 2.f, (v1.y + v2.y) / 2.f) - center;
+	}
+	// same naming as before: the arm pointing down is c, of the other two
+	// the one to the right is b. Two arms equally far down, as in an upside
+	// down Y, are ordered left to right, so c is the same with every std::sort
+	array<int, 3> order = { 0, 1, 2 };
+	sort(order.begin(), order.end(), [&](int l, int r) {
+		if (directions[l].y != directions[r].y) {
+			return directions[l].y > directions[r].y;
+		}
+		return directions[l].x < directions[r].x;
+	});
+	array<Zone, 3> names;
+	names[order[0]] = ZONE_C;
+	if (directions[order[1]].x > directions[order[2]].x) {
+		names[order[1]] = ZONE_B;
+		names[order[2]] = ZONE_A;
+	} else {
+		names[order[1]] = ZONE_A;
+		names[order[2]] = ZONE_B;
+	}
+
+	for (auto i = 0; i < 3; i++) {
+		vector<Point> wedge = { Point(center), farPoint(triangle[i]), farPoint(triangle[(i + 1) % 3]) };
+		fillConvexPoly(labelImage, wedge, Scalar(names[i]));
+	}
+	vector<Point> centerZone(triangle.begin(), triangle.end());
+	fillConvexPoly(labelImage, centerZone, Scalar(ZONE_CENTER));
+}
+
+void ZoneMap::addPolygon(Zone zone, const vector<Point>& polygon) {
+	fillPoly(labelImage, vector<vector<Point>>{ polygon }, Scalar(zone));
+}
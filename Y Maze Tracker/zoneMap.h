@@ -0,0 +1,35 @@
+// zoneMap.h : the maze zones rasterized once into a label image, so every
+// frame is classified with a single lookup whatever the maze orientation.
+//
+
+#pragma once
+
+#include "trackingEngine.h"
+
+#include <opencv2/core.hpp>
+
+#include <algorithm>
+#include <array>
+#include <vector>
+
+class ZoneMap {
+public:
+	ZoneMap() {}
+	// the center triangle plus one wedge per arm, bounded by the rays from the
+	// triangle centroid through its vertices
+	ZoneMap(cv::Size size, const std::array<cv::Point, 3>& triangle);
+
+	// paints an arbitrary zone over the existing labels
+	void addPolygon(Zone zone, const std::vector<cv::Point>& polygon);
+
+	Zone classify(cv::Point pt) const {
+		pt.x = std::min(std::max(pt.x, 0), labelImage.cols - 1);
+		pt.y = std::min(std::max(pt.y, 0), labelImage.rows - 1);
+		return (Zone)labelImage.at<unsigned char>(pt.y, pt.x);
+	}
+
+	const cv::Mat& labels() const { return labelImage; }
+
+private:
+	cv::Mat labelImage;
+};